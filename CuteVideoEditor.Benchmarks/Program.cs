@@ -0,0 +1,48 @@
+using CuteVideoEditor_Video;
+using System.Text.Json;
+
+// CuteVideoEditor.Benchmarks [--output results.json] [--clip file] [--width 1920] [--height 1080] [--fps 30] [--seconds 20]
+// Without --clip, a synthetic clip is generated with the given size, frame rate and length, so runs on different
+// machines measure the same content.
+var options = args.Chunk(2).Where(pair => pair.Length == 2 && pair[0].StartsWith("--"))
+    .ToDictionary(pair => pair[0][2..], pair => pair[1]);
+string Option(string name, string defaultValue) => options.GetValueOrDefault(name, defaultValue);
+
+var outputFileName = Path.GetFullPath(Option("output", "benchmark-results.json"));
+var width = int.Parse(Option("width", "1920"));
+var height = int.Parse(Option("height", "1080"));
+var frameRate = int.Parse(Option("fps", "30"));
+var seconds = int.Parse(Option("seconds", "20"));
+
+var workDirectory = Directory.CreateTempSubdirectory("cve-benchmark-");
+try
+{
+    var clipFileName = options.TryGetValue("clip", out var clip) ? Path.GetFullPath(clip) : Path.Combine(workDirectory.FullName, "clip.mp4");
+    if (clip is null)
+    {
+        Console.WriteLine($"Generating a {width}x{height} {frameRate} fps {seconds}s test clip...");
+        VideoBenchmark.GenerateTestClip(clipFileName, width, height, frameRate, frameRate * seconds);
+    }
+
+    Console.WriteLine($"Benchmarking {clipFileName}...");
+    var results = VideoBenchmark.Run(clipFileName, workDirectory.FullName);
+    foreach (var result in results)
+        Console.WriteLine($"{result.Name,-32} {result.Value,12:0.###} {result.Unit}");
+
+    await using var outputStream = File.Create(outputFileName);
+    await JsonSerializer.SerializeAsync(outputStream, new
+    {
+        timestamp = DateTimeOffset.Now,
+        machine = Environment.MachineName,
+        processorCount = Environment.ProcessorCount,
+        clip,
+        generatedClip = clip is null ? new { width, height, frameRate, seconds } : null,
+        results = results.Select(result => new { name = result.Name, value = result.Value, unit = result.Unit }),
+    }, new JsonSerializerOptions { WriteIndented = true });
+
+    Console.WriteLine($"Results written to {outputFileName}.");
+}
+finally
+{
+    workDirectory.Delete(true);
+}
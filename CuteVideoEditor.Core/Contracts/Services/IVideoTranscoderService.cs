@@ -1,8 +1,10 @@
 ﻿using CuteVideoEditor.Core.Models;
+using CuteVideoEditor_Video;
 using Windows.Graphics.Imaging;
 
 namespace CuteVideoEditor.Core.Contracts.Services;
 public interface IVideoTranscoderService
 {
-    void Transcode(VideoTranscodeInput input, VideoTranscodeOutput output, Action<ulong, SoftwareBitmap?> frameProcessed);
+    void Transcode(VideoTranscodeInput input, VideoTranscodeOutput output, Action<TranscodeProgressEventArgs> progress,
+        Action<SoftwareBitmap>? framePreview = null);
 }
\ No newline at end of file
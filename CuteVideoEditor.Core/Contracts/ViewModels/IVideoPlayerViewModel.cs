@@ -6,6 +6,7 @@ namespace CuteVideoEditor.Core.Contracts.ViewModels;
 public interface IVideoPlayerViewModel : INotifyPropertyChanging, INotifyPropertyChanged, IDisposable
 {
     string? MediaFileName { get; set; }
+    string? PacketIndexFileName { get; set; }
     TimeSpan InputMediaPosition { get; set; }
     long InputFrameNumber { get; set; }
     TimeSpan InputMediaDuration { get; }
@@ -14,6 +15,9 @@ public interface IVideoPlayerViewModel : INotifyPropertyChanging, INotifyPropert
     TimeSpan OutputMediaDuration { get; }
     double MediaFrameRate { get; }
     MediaPlayerState MediaPlayerState { get; set; }
+    SizeModel PreviewPixelSize { get; set; }
+    bool FullResolutionPreview { get; set; }
+    bool Scrubbing { get; set; }
 
     ObservableCollection<TrimmingMarkerModel> TrimmingMarkers { get; }
 
@@ -7,7 +7,13 @@ public class VideoTranscodeOutput
     public required string FileName { get; set; }
     public required OutputType OutputType { get; set; }
     public required uint Crf { get; set; }
+    public required OutputPresetType Preset { get; set; }
     public required int PixelWidth { get; set; }
     public required int PixelHeight { get; set; }
     public required double FrameRateMultiplier { get; set; }
+    public bool SegmentParallel { get; set; }
+    public bool SmartRender { get; set; }
+    public RateControlMode RateControl { get; set; }
+    public uint BitrateKbps { get; set; }
+    public bool SceneDetection { get; set; }
 }
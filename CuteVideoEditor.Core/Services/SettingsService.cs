@@ -11,6 +11,7 @@ public class SettingsService
     {
         public uint LastCrf { get; set; } = 12;
         public OutputType LastVideoOutputType { get; set; } = OutputType.Vp9;
+        public OutputPresetType LastOutputPreset { get; set; } = OutputPresetType.Medium;
     }
     SettingsJsonModel model;
 
@@ -64,4 +65,10 @@ public class SettingsService
         get => model.LastVideoOutputType;
         set { model.LastVideoOutputType = value; SaveSettings(); }
     }
+
+    public OutputPresetType LastOutputPreset
+    {
+        get => model.LastOutputPreset;
+        set { model.LastOutputPreset = value; SaveSettings(); }
+    }
 }
@@ -9,6 +9,8 @@ namespace CuteVideoEditor.ViewModels.Dialogs;
 public partial class ExportVideoViewModel(SettingsService settingsService) : ObservableObject
 {
     public OutputType[] OutputFileTypes { get; } = [.. Enum.GetValues<OutputType>()];
+    public OutputPresetType[] OutputPresetTypes { get; } = [.. Enum.GetValues<OutputPresetType>()];
+    public RateControlMode[] RateControlModes { get; } = [.. Enum.GetValues<RateControlMode>()];
 
     [ObservableProperty]
     [NotifyPropertyChangedFor(nameof(IsValid))]
@@ -20,6 +22,9 @@ public partial class ExportVideoViewModel(SettingsService settingsService) : Obs
     [ObservableProperty]
     uint crf = settingsService.LastCrf;
 
+    [ObservableProperty]
+    OutputPresetType preset = settingsService.LastOutputPreset;
+
     [ObservableProperty]
     double frameRateMultiplier = 1;
 
@@ -29,20 +34,43 @@ public partial class ExportVideoViewModel(SettingsService settingsService) : Obs
     [ObservableProperty]
     double originalFrameRate;
 
-    public bool IsValid => !string.IsNullOrWhiteSpace(FileName);
+    [ObservableProperty]
+    bool segmentParallel;
+
+    [ObservableProperty]
+    bool smartRender;
+
+    [ObservableProperty]
+    [NotifyPropertyChangedFor(nameof(UsesBitrate))]
+    [NotifyPropertyChangedFor(nameof(IsValid))]
+    RateControlMode rateControl;
+
+    [ObservableProperty]
+    [NotifyPropertyChangedFor(nameof(IsValid))]
+    uint bitrateKbps = 8000;
+
+    [ObservableProperty]
+    bool sceneDetection;
+
+    public bool UsesBitrate => RateControl != RateControlMode.Crf;
+
+    public bool IsValid => !string.IsNullOrWhiteSpace(FileName) && (!UsesBitrate || BitrateKbps > 0);
 
+    // only switch types when the extension doesn't fit the current one, several types share .webm
     partial void OnFileNameChanged(string? value) =>
-        Type = value is null ? Type : Path.GetExtension(value) switch
+        Type = value is null ? Type : (Path.GetExtension(value), Type) switch
         {
-            ".webm" => OutputType.Vp9,
+            (".webm", OutputType.Vp9 or OutputType.Vp8 or OutputType.Av1) => Type,
+            (".webm", _) => OutputType.Vp9,
+            (_, OutputType.Mp4Hevc) => Type,
             _ => OutputType.Mp4
         };
 
     partial void OnTypeChanged(OutputType value) =>
         FileName = FileName is null ? null : value switch
         {
-            OutputType.Vp9 or OutputType.Vp8 => Path.ChangeExtension(FileName, ".webm"),
-            OutputType.Mp4 => Path.ChangeExtension(FileName, ".mp4"),
+            OutputType.Vp9 or OutputType.Vp8 or OutputType.Av1 => Path.ChangeExtension(FileName, ".webm"),
+            OutputType.Mp4 or OutputType.Mp4Hevc => Path.ChangeExtension(FileName, ".mp4"),
             _ => throw new NotImplementedException()
         };
 
@@ -51,7 +79,13 @@ public partial class ExportVideoViewModel(SettingsService settingsService) : Obs
         FileName = FileName!,
         OutputType = Type,
         Crf = Crf,
+        Preset = Preset,
         FrameRateMultiplier = FrameRateMultiplier,
+        SegmentParallel = SegmentParallel,
+        SmartRender = SmartRender,
+        RateControl = RateControl,
+        BitrateKbps = BitrateKbps,
+        SceneDetection = SceneDetection,
         PixelWidth = (mainViewModel.LargestOutputPixelSize * PixelSizeMultiplier).Width,
         PixelHeight = (mainViewModel.LargestOutputPixelSize * PixelSizeMultiplier).Height,
     };
@@ -244,8 +244,6 @@ public partial class VideoEditorViewModel : ObservableRecipient, IDisposable
 
             var encodingResult = await dialogService.ShowOperationProgressDialog("Please wait, encoding...", true, async vm =>
             {
-                var totalFrames = VideoPlayerViewModel.GetFrameNumberFromPosition(VideoPlayerViewModel.OutputMediaDuration);
-
                 await Task.Run(() =>
                 {
                     try
@@ -258,11 +256,18 @@ public partial class VideoEditorViewModel : ObservableRecipient, IDisposable
                                 CropFrames = CropFrames,
                                 TrimmingMarkers = VideoPlayerViewModel.TrimmingMarkers,
                                 EncoderTitle = $"CuteVideoEditor {Assembly.GetEntryAssembly()?.GetCustomAttribute<AssemblyInformationalVersionAttribute>()?.InformationalVersion}",
-                            }, outputParameters, (processedFrames, frameBitmap) => mainSyncronizationContext.Post(_ =>
+                            }, outputParameters, progress => mainSyncronizationContext.Post(_ =>
                             {
-                                vm.Progress = (double)processedFrames / totalFrames;
-                                vm.PreviewFrame = frameBitmap;
-                            }, null));
+                                if (progress.AnalyzingScenes)
+                                {
+                                    vm.Progress = progress.TotalFrameCount > 0 ? (double)progress.DecodedFrameCount / progress.TotalFrameCount : 0;
+                                    vm.Description = $"Please wait, analyzing scenes... {progress.DecodeFps:0.#} fps";
+                                    return;
+                                }
+
+                                vm.Progress = progress.TotalFrameCount > 0 ? (double)progress.EncodedFrameCount / progress.TotalFrameCount : 0;
+                                vm.Description = $@"Please wait, encoding... {progress.EncodeFps:0.#} fps, {progress.Eta:hh\:mm\:ss} left";
+                            }, null), frameBitmap => mainSyncronizationContext.Post(_ => vm.PreviewFrame = frameBitmap, null));
                         encodingDuration = sw.Elapsed;
 
                         vm.Result = true;
@@ -382,6 +387,7 @@ public partial class VideoEditorViewModel : ObservableRecipient, IDisposable
                     VideoPlayerViewModel.TrimmingMarkers.Clear();
                     VideoPlayerViewModel.TrimmingMarkers.AddRange(mapper.Map<List<TrimmingMarkerModel>>(model.TrimmingMarkers));
 
+                    VideoPlayerViewModel.PacketIndexFileName = Path.ChangeExtension(projectFileName, ".cveindex");
                     VideoPlayerViewModel.MediaFileName = Path.GetDirectoryName(projectFileName) is { } projectDirectoryName ? Path.Combine(projectDirectoryName, model.MediaFileName) : model.MediaFileName;
                     return;
                 }
@@ -390,6 +396,7 @@ public partial class VideoEditorViewModel : ObservableRecipient, IDisposable
 
         // if we couldn't parse it as a project file, load it as a video file
         ProjectFileName = null;
+        VideoPlayerViewModel.PacketIndexFileName = null;
         VideoPlayerViewModel.MediaFileName = projectFileName;
 
         CropFrames.Clear();
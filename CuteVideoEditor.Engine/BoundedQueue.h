@@ -0,0 +1,73 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Blocking FIFO with a fixed capacity, used to hand frames between the stages of the encoding pipeline.
+// Closing the queue lets consumers drain what's left, aborting it drops everything and releases all waiters.
+template<typename T>
+class BoundedQueue
+{
+	std::mutex mutex;
+	std::condition_variable notEmpty, notFull;
+	std::deque<T> items;
+	size_t capacity;
+	bool closed{}, aborted{};
+
+public:
+	explicit BoundedQueue(size_t capacity) : capacity(capacity) { }
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	// blocks while the queue is full, returns false if the queue was closed or aborted
+	bool Push(T&& item)
+	{
+		std::unique_lock lock(mutex);
+		notFull.wait(lock, [&] { return items.size() < capacity || closed || aborted; });
+		if (closed || aborted)
+			return false;
+
+		items.emplace_back(std::move(item));
+		notEmpty.notify_one();
+		return true;
+	}
+
+	// blocks while the queue is empty, returns false once the queue is drained and closed, or aborted
+	bool Pop(T& item)
+	{
+		std::unique_lock lock(mutex);
+		notEmpty.wait(lock, [&] { return !items.empty() || closed || aborted; });
+		if (aborted || items.empty())
+			return false;
+
+		item = std::move(items.front());
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	size_t Size()
+	{
+		std::lock_guard lock(mutex);
+		return items.size();
+	}
+
+	void Close()
+	{
+		std::lock_guard lock(mutex);
+		closed = true;
+		notEmpty.notify_all();
+		notFull.notify_all();
+	}
+
+	void Abort()
+	{
+		std::lock_guard lock(mutex);
+		aborted = true;
+		items.clear();
+		notEmpty.notify_all();
+		notFull.notify_all();
+	}
+};
@@ -0,0 +1,74 @@
+#include "EngineCommon.h"
+#include "DecodedFrameCache.h"
+
+using namespace std;
+
+void DecodedFrameCache::Add(AVFrame* frame)
+{
+	auto pts = frame->best_effort_timestamp;
+	if (pts == AV_NOPTS_VALUE)
+		return;
+
+	if (auto it = entryIndex.find(pts); it != entryIndex.end())
+	{
+		Touch(it->second);
+		return;
+	}
+
+	AutoReleasePtr<AVFrame, av_frame_free> frameRef = av_frame_clone(frame);
+	if (!frameRef)
+		throw bad_alloc();
+
+	size_t frameByteSize = 0;
+	for (auto buffer : frameRef->buf)
+		if (buffer)
+			frameByteSize += buffer->size;
+
+	entries.push_front({ pts, move(frameRef), frameByteSize });
+	entryIndex.emplace(pts, entries.begin());
+	byteSize += frameByteSize;
+
+	Evict();
+}
+
+AVFrame* DecodedFrameCache::Find(int64_t pts, int64_t tolerance)
+{
+	auto bestEntry = entries.end();
+	int64_t bestDistance{};
+
+	for (auto it = entryIndex.lower_bound(pts - tolerance); it != entryIndex.end() && it->first <= pts + tolerance; ++it)
+		if (auto distance = abs(it->first - pts); bestEntry == entries.end() || distance < bestDistance)
+		{
+			bestEntry = it->second;
+			bestDistance = distance;
+		}
+
+	if (bestEntry == entries.end())
+		return nullptr;
+
+	Touch(bestEntry);
+	return &*bestEntry->frame;
+}
+
+void DecodedFrameCache::Clear()
+{
+	entryIndex.clear();
+	entries.clear();
+	byteSize = 0;
+}
+
+void DecodedFrameCache::SetByteBudget(size_t value)
+{
+	byteBudget = value;
+	Evict();
+}
+
+void DecodedFrameCache::Evict()
+{
+	while (byteSize > byteBudget && !entries.empty())
+	{
+		byteSize -= entries.back().byteSize;
+		entryIndex.erase(entries.back().pts);
+		entries.pop_back();
+	}
+}
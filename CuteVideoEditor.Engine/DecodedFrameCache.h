@@ -0,0 +1,39 @@
+#pragma once
+
+#include <list>
+#include <map>
+
+// Memory bounded cache of decoded frames keyed by their presentation timestamp, evicting the least recently used
+// frames once the byte budget is exceeded. The frames are references, so caching costs no copies.
+class DecodedFrameCache
+{
+public:
+	explicit DecodedFrameCache(size_t byteBudget) : byteBudget(byteBudget) { }
+
+	void Add(AVFrame* frame);
+
+	// finds the frame closest to pts, no further than tolerance away from it; the frame stays valid until the next Add
+	AVFrame* Find(int64_t pts, int64_t tolerance);
+
+	void Clear();
+
+	size_t GetByteBudget() const { return byteBudget; }
+	void SetByteBudget(size_t value);
+	size_t GetByteSize() const { return byteSize; }
+
+private:
+	struct Entry
+	{
+		int64_t pts;
+		AutoReleasePtr<AVFrame, av_frame_free> frame;
+		size_t byteSize;
+	};
+
+	void Touch(std::list<Entry>::iterator entry) { entries.splice(entries.begin(), entries, entry); }
+	void Evict();
+
+	// most recently used first, indexed by timestamp for the range lookups
+	std::list<Entry> entries;
+	std::map<int64_t, std::list<Entry>::iterator> entryIndex;
+	size_t byteBudget, byteSize{};
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+// Common header of the engine, everything here has to build on every platform the engine runs on:
+// no Windows or WinRT types, errors are standard exceptions and strings are UTF-8.
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244)
+#endif
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavcodec/bsf.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+#include <libavutil/cpu.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+}
+
+#ifdef _MSC_VER
+#pragma warning(default : 4244)
+#endif
+
+#include "AutoReleasePtr.h"
+#include <asyncpp/generator.h>
+
+// media positions in 100ns ticks, the same type as WinRT's TimeSpan so positions cross the WinRT layer as they are
+using MediaTime = std::chrono::duration<int64_t, std::ratio<1, 10'000'000>>;
+
+MediaTime inline MediaTimeFromSeconds(double seconds)
+{
+	return std::chrono::duration_cast<MediaTime>(std::chrono::nanoseconds(static_cast<int64_t>(seconds * 1e9)));
+}
+
+double inline MediaTimeToSeconds(MediaTime time)
+{
+	return std::chrono::duration_cast<std::chrono::duration<double>>(time).count();
+}
+
+// UTF-8 paths, so file names survive the trip through FFmpeg's char* API on every platform
+std::filesystem::path inline PathFromUtf8(std::string_view utf8)
+{
+	return std::filesystem::path{ std::u8string_view{ reinterpret_cast<const char8_t*>(utf8.data()), utf8.size() } };
+}
+
+std::string inline PathToUtf8(const std::filesystem::path& path)
+{
+	auto utf8 = path.u8string();
+	return { reinterpret_cast<const char*>(utf8.data()), utf8.size() };
+}
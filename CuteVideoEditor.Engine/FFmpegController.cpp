@@ -0,0 +1,1768 @@
+#include "EngineCommon.h"
+#include "FFmpegController.h"
+#include "BoundedQueue.h"
+
+using namespace std;
+using namespace chrono;
+
+static AVCodecID GetCodecId(FFmpegControllerOutputType type)
+{
+	switch (type)
+	{
+	case FFmpegControllerOutputType::Mp4:
+		return AV_CODEC_ID_H264;
+	case FFmpegControllerOutputType::Vp8:
+		return AV_CODEC_ID_VP8;
+	case FFmpegControllerOutputType::Vp9:
+		return AV_CODEC_ID_VP9;
+	case FFmpegControllerOutputType::Av1:
+		return AV_CODEC_ID_AV1;
+	case FFmpegControllerOutputType::Mp4Hevc:
+		return AV_CODEC_ID_HEVC;
+	default:
+		throw invalid_argument("Unknown output type.");
+	}
+}
+
+// the tag of a stream copied into a new container: the muxer's default, except for HEVC in MP4/MOV, which players
+// (QuickTime, browsers) only accept as hvc1 rather than hev1
+static uint32_t GetRemuxCodecTag(const AVFormatContext& formatContext, const AVCodecParameters& codecParameters)
+{
+	if (codecParameters.codec_id != AV_CODEC_ID_HEVC)
+		return 0;
+
+	auto muxerName = string_view{ formatContext.oformat->name };
+	return muxerName.find("mp4") != string_view::npos || muxerName.find("mov") != string_view::npos ? MKTAG('h', 'v', 'c', '1') : 0;
+}
+
+void FFmpegController::throw_av_error(int ret)
+{
+	if (ret < 0)
+	{
+		char err[AV_ERROR_MAX_STRING_SIZE];
+		av_make_error_string(err, sizeof err, ret);
+		av_log(nullptr, AV_LOG_ERROR, "%s\n", err);
+
+		throw runtime_error(err);
+	}
+}
+#define check_av_result(cmd) do { if((ret = cmd) < 0) throw_av_error(ret); } while(0)
+#define check_av_pointer(ptr) do { if(!(ptr)) { av_log(nullptr, AV_LOG_ERROR, "Pointer returned as null.\n"); throw runtime_error("Pointer returned as null."); } } while(0)
+
+void FFmpegController::OpenInputVideo(const char* filenameUtf8, bool dumpFormat, bool scanPacketIndex, const char* packetIndexFilenameUtf8)
+{
+	int ret;
+
+	check_av_result(avformat_open_input(&inputFormatContext, filenameUtf8, nullptr, nullptr));
+
+	// a valid sidecar index already knows everything stream probing would find out
+	auto mediaPath = PathFromUtf8(filenameUtf8);
+	auto packetIndexPath = packetIndexFilenameUtf8 ? PathFromUtf8(packetIndexFilenameUtf8) : filesystem::path{};
+	if (packetIndexFilenameUtf8 && packetIndexFile.Open(packetIndexPath, mediaPath)
+		&& packetIndexFile.GetHeader().videoStreamIndex < (int)inputFormatContext->nb_streams)
+	{
+		auto& header = packetIndexFile.GetHeader();
+		inputVideoStream = inputFormatContext->streams[header.videoStreamIndex];
+		inputVideoStream->r_frame_rate = header.frameRate;
+		inputVideoStream->codecpar->video_delay = header.hasBFrames;
+		if (inputVideoStream->codecpar->format < 0)
+			inputVideoStream->codecpar->format = header.pixelFormat;
+		inputFormatContext->duration = header.duration;
+	}
+	else
+	{
+		packetIndexFile.Close();
+		check_av_result(avformat_find_stream_info(&*inputFormatContext, nullptr));
+
+		auto inputVideoStreamIndex = av_find_best_stream(&*inputFormatContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+		check_av_result(inputVideoStreamIndex);
+		inputVideoStream = inputFormatContext->streams[inputVideoStreamIndex];
+	}
+
+	auto inputCodec = avcodec_find_decoder(inputVideoStream->codecpar->codec_id);
+	check_av_pointer(inputCodec);
+
+	inputCodecContext = avcodec_alloc_context3(inputCodec);
+	check_av_pointer(inputCodecContext);
+	check_av_result(avcodec_parameters_to_context(&*inputCodecContext, inputVideoStream->codecpar));
+
+	inputCodecContext->framerate = packetIndexFile.IsOpen() ? packetIndexFile.GetHeader().guessedFrameRate
+		: av_guess_frame_rate(&*inputFormatContext, inputVideoStream, nullptr);
+	inputCodecContext->pkt_timebase = inputVideoStream->time_base;
+	inputCodecContext->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+
+	// multi-threaded decoding
+	inputCodecContext->thread_count = decoderThreadCount;
+	if (inputCodec->capabilities & AV_CODEC_CAP_FRAME_THREADS)
+	{
+		inputCodecContext->thread_type = FF_THREAD_FRAME;
+		inputThreadType = FFmpegControllerThreadedType::FrameThreads;
+	}
+	else if (inputCodec->capabilities & AV_CODEC_CAP_SLICE_THREADS)
+	{
+		inputCodecContext->thread_type = FF_THREAD_SLICE;
+		inputThreadType = FFmpegControllerThreadedType::SlideThreads;
+	}
+	else
+	{
+		inputCodecContext->thread_count = 1;
+		inputThreadType = FFmpegControllerThreadedType::SingleThread;
+	}
+
+	check_av_result(avcodec_open2(&*inputCodecContext, inputCodec, nullptr));
+
+	mediaDuration = MediaTime{ inputFormatContext->duration * 10 };
+	frameRate = av_q2d(inputVideoStream->r_frame_rate);
+
+	if (packetIndexFile.IsOpen())
+	{
+		packetIndex = packetIndexFile.GetEntries();
+		keyframePacketIndices = packetIndexFile.GetKeyframePacketIndices();
+		BuildFrameTimestampMap();
+	}
+	else
+	{
+		BuildPacketIndex(scanPacketIndex);
+
+		if (packetIndexFilenameUtf8 && !packetIndex.empty())
+		{
+			PacketIndexFile::Header header{};
+			header.videoStreamIndex = inputVideoStream->index;
+			header.hasBFrames = inputCodecContext->has_b_frames;
+			header.pixelFormat = inputCodecContext->pix_fmt;
+			header.frameRate = inputVideoStream->r_frame_rate;
+			header.guessedFrameRate = inputCodecContext->framerate;
+			header.duration = inputFormatContext->duration;
+			if (!PacketIndexFile::Write(packetIndexPath, mediaPath, header, packetIndex, keyframePacketIndices))
+				av_log(nullptr, AV_LOG_WARNING, "Could not write the packet index file %s.\n", packetIndexFilenameUtf8);
+		}
+	}
+
+	if (dumpFormat)
+		av_dump_format(&*inputFormatContext, 0, filenameUtf8, 0);
+}
+
+void FFmpegController::BuildPacketIndex(bool scanPackets)
+{
+	int ret;
+
+	ownedPacketIndex.clear();
+	ownedKeyframePacketIndices.clear();
+
+	if (scanPackets)
+	{
+		// packet only scan, nothing gets decoded; done even when the container has an index of its own, since that one
+		// never knows the pts (and mkv cues only list keyframes), which frame-exact seeking needs
+		AutoReleasePtr<AVPacket, av_packet_free> packet = av_packet_alloc();
+		check_av_pointer(packet);
+
+		while (av_read_frame(&*inputFormatContext, &*packet) >= 0)
+		{
+			if (packet->stream_index == inputVideoStream->index)
+				ownedPacketIndex.push_back({ packet->pts, packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts,
+					packet->pos, packet->size, (packet->flags & AV_PKT_FLAG_KEY) != 0 });
+			av_packet_unref(&*packet);
+		}
+
+		check_av_result(av_seek_frame(&*inputFormatContext, inputVideoStream->index,
+			inputVideoStream->start_time != AV_NOPTS_VALUE ? inputVideoStream->start_time : 0, AVSEEK_FLAG_BACKWARD));
+		avcodec_flush_buffers(&*inputCodecContext);
+
+		stable_sort(ownedPacketIndex.begin(), ownedPacketIndex.end(), [](auto& a, auto& b) { return a.dts < b.dts; });
+	}
+	else if (auto entryCount = avformat_index_get_entries_count(inputVideoStream); entryCount > 0)
+	{
+		// the container already has an index (mp4 sample tables, mkv cues), it just doesn't know the pts
+		ownedPacketIndex.reserve(entryCount);
+		for (int i = 0; i < entryCount; ++i)
+		{
+			auto entry = avformat_index_get_entry(inputVideoStream, i);
+			ownedPacketIndex.push_back({ AV_NOPTS_VALUE, entry->timestamp, entry->pos, entry->size, (entry->flags & AVINDEX_KEYFRAME) != 0 });
+		}
+	}
+
+	for (size_t i = 0; i < ownedPacketIndex.size(); ++i)
+		if (ownedPacketIndex[i].keyframe)
+			ownedKeyframePacketIndices.push_back(i);
+
+	packetIndex = ownedPacketIndex;
+	keyframePacketIndices = ownedKeyframePacketIndices;
+	BuildFrameTimestampMap();
+}
+
+void FFmpegController::SharePacketIndex(const FFmpegController& other)
+{
+	ownedPacketIndex.clear();
+	ownedKeyframePacketIndices.clear();
+	packetIndex = other.packetIndex;
+	keyframePacketIndices = other.keyframePacketIndices;
+	framePresentationTimestamps = other.framePresentationTimestamps;
+}
+
+void FFmpegController::BuildFrameTimestampMap()
+{
+	framePresentationTimestamps.clear();
+	if (any_of(packetIndex.begin(), packetIndex.end(), [](auto& entry) { return entry.pts == AV_NOPTS_VALUE; }))
+		return;
+
+	framePresentationTimestamps.reserve(packetIndex.size());
+	for (auto& entry : packetIndex)
+		framePresentationTimestamps.push_back(entry.pts);
+	sort(framePresentationTimestamps.begin(), framePresentationTimestamps.end());
+}
+
+int64_t FFmpegController::GetKeyframePresentationTimestamp(const PacketIndexEntry& entry) const
+{
+	if (entry.pts != AV_NOPTS_VALUE)
+		return entry.pts;
+
+	// container indices only carry dts, assume the keyframe is presented after the decoder's full reorder delay
+	return entry.dts + llround(inputCodecContext->has_b_frames / frameRate / av_q2d(inputVideoStream->time_base));
+}
+
+const PacketIndexEntry* FFmpegController::FindSeekKeyframe(int64_t pts) const
+{
+	// last keyframe presented at or before pts
+	auto it = upper_bound(keyframePacketIndices.begin(), keyframePacketIndices.end(), pts,
+		[&](int64_t targetPts, uint64_t keyframePacketIndex) { return targetPts < GetKeyframePresentationTimestamp(packetIndex[keyframePacketIndex]); });
+
+	if (it == keyframePacketIndices.begin())
+		return keyframePacketIndices.empty() ? nullptr : &packetIndex[keyframePacketIndices.front()];
+	return &packetIndex[*prev(it)];
+}
+
+static const AVCodec* FindEncoder(FFmpegControllerOutputType type, bool twoPass)
+{
+	// SVT-AV1 is by far the fastest of the AV1 encoders, libaom is the fallback and the only one FFmpeg can run in two passes
+	if (type == FFmpegControllerOutputType::Av1 && !twoPass)
+		if (auto codec = avcodec_find_encoder_by_name("libsvtav1"))
+			return codec;
+	return avcodec_find_encoder(GetCodecId(type));
+}
+
+// x264-params, x265-params and svtav1-params are dictionary options, setting one again replaces everything set before
+static void AppendCodecParams(AVCodecContext& ctx, const char* option, const string& params)
+{
+	int ret;
+
+	uint8_t* currentParams{};
+	check_av_result(av_opt_get(ctx.priv_data, option, 0, &currentParams));
+	auto allParams = currentParams && *currentParams ? format("{}:{}", reinterpret_cast<const char*>(currentParams), params) : params;
+	av_free(currentParams);
+	check_av_result(av_opt_set(ctx.priv_data, option, allParams.c_str(), 0));
+}
+
+static void AppendX265Params(AVCodecContext& ctx, const string& params)
+{
+	AppendCodecParams(ctx, "x265-params", params);
+}
+
+static const char* GetX264PresetName(FFmpegControllerPresetType preset)
+{
+	switch (preset)
+	{
+	case FFmpegControllerPresetType::UltraFast: return "ultrafast";
+	case FFmpegControllerPresetType::SuperFast: return "superfast";
+	case FFmpegControllerPresetType::VeryFast: return "veryfast";
+	case FFmpegControllerPresetType::Faster: return "faster";
+	case FFmpegControllerPresetType::Fast: return "fast";
+	case FFmpegControllerPresetType::Medium: return "medium";
+	case FFmpegControllerPresetType::Slow: return "slow";
+	case FFmpegControllerPresetType::Slower: return "slower";
+	case FFmpegControllerPresetType::VerySlow: return "veryslow";
+	case FFmpegControllerPresetType::Placebo: return "placebo";
+	case FFmpegControllerPresetType::Draft: return "ultrafast";
+	default:
+		throw invalid_argument("Unknown preset.");
+	}
+}
+
+// libvpx speed for a preset: the fast end runs in realtime mode, which is where cpu-used goes past 5
+static pair<const char*, int> GetVpxDeadlineAndSpeed(FFmpegControllerPresetType preset)
+{
+	switch (preset)
+	{
+	case FFmpegControllerPresetType::Draft:
+	case FFmpegControllerPresetType::UltraFast: return { "realtime", 8 };
+	case FFmpegControllerPresetType::SuperFast: return { "realtime", 7 };
+	case FFmpegControllerPresetType::VeryFast: return { "realtime", 6 };
+	case FFmpegControllerPresetType::Faster: return { "good", 5 };
+	case FFmpegControllerPresetType::Fast: return { "good", 5 };
+	case FFmpegControllerPresetType::Medium: return { "good", 4 };
+	case FFmpegControllerPresetType::Slow: return { "good", 3 };
+	case FFmpegControllerPresetType::Slower: return { "good", 2 };
+	case FFmpegControllerPresetType::VerySlow: return { "good", 1 };
+	case FFmpegControllerPresetType::Placebo: return { "best", 0 };
+	default:
+		throw invalid_argument("Unknown preset.");
+	}
+}
+
+// SVT-AV1 presets run from 0 (slowest) to 13, libaom's cpu-used from 0 to 8
+static int GetAv1Speed(FFmpegControllerPresetType preset, bool svt)
+{
+	static constexpr int svtSpeeds[] = { 12, 11, 10, 9, 8, 7, 5, 4, 2, 1, 13 };
+	static constexpr int aomSpeeds[] = { 8, 7, 7, 6, 5, 4, 3, 2, 1, 0, 8 };
+
+	auto index = static_cast<size_t>(preset);
+	if (index >= size(svtSpeeds))
+		throw invalid_argument("Unknown preset.");
+	return svt ? svtSpeeds[index] : aomSpeeds[index];
+}
+
+void FFmpegController::SetupEncodingParameters(AVCodecContext& ctx, FFmpegControllerOutputType outputType, uint32_t crf, FFmpegControllerPresetType preset)
+{
+	int ret;
+
+	ctx.thread_count = encoderThreadCount > 0 ? encoderThreadCount : static_cast<int>(clamp(thread::hardware_concurrency(), 1u, 16u));
+	ctx.slices = 8; // also VP8's token partitions, which is what its threads split the frame by
+
+	// drafts are for a quick look, skip everything that needs frames buffered ahead
+	auto draft = preset == FFmpegControllerPresetType::Draft;
+	ctx.max_b_frames = draft ? 0 : 2;
+
+	switch (outputType)
+	{
+	case FFmpegControllerOutputType::Mp4:
+	{
+		// crf, preset
+		check_av_result(av_opt_set_int(ctx.priv_data, "crf", crf, 0));
+		check_av_result(av_opt_set(ctx.priv_data, "preset", GetX264PresetName(preset), 0));
+		if (draft)
+			check_av_result(av_opt_set(ctx.priv_data, "tune", "fastdecode,zerolatency", 0));
+
+		// planned keyframes have to be IDR frames to start a new GOP
+		check_av_result(av_opt_set_int(ctx.priv_data, "forced-idr", 1, 0));
+		break;
+	}
+	case FFmpegControllerOutputType::Mp4Hevc:
+	{
+		// x265 shares x264's preset names, but ignores thread_count: it threads over frames in flight and
+		// a worker pool, so size both from the thread budget (frame-threads like x265's own auto-detection)
+		auto frameThreads = ctx.thread_count >= 32 ? 6 : ctx.thread_count >= 16 ? 5 : ctx.thread_count >= 8 ? 3 : ctx.thread_count >= 4 ? 2 : 1;
+
+		check_av_result(av_opt_set_int(ctx.priv_data, "crf", crf, 0));
+		check_av_result(av_opt_set(ctx.priv_data, "preset", GetX264PresetName(preset), 0));
+		if (draft)
+			check_av_result(av_opt_set(ctx.priv_data, "tune", "fastdecode", 0));
+		check_av_result(av_opt_set_int(ctx.priv_data, "forced-idr", 1, 0));
+		check_av_result(av_opt_set(ctx.priv_data, "x265-params",
+			format("frame-threads={}:pools={}:log-level=warning", frameThreads, ctx.thread_count).c_str(), 0));
+
+		// players (QuickTime, browsers) only accept HEVC in mp4 tagged as hvc1 rather than hev1
+		ctx.codec_tag = MKTAG('h', 'v', 'c', '1');
+		break;
+	}
+	case FFmpegControllerOutputType::Vp8:
+	{
+		// constrained quality, libvpx needs a bitrate ceiling for it in VP8 mode: a generous bit per 4 pixels
+		auto [deadline, speed] = GetVpxDeadlineAndSpeed(preset);
+		auto realtime = deadline == string_view{ "realtime" };
+
+		auto vp8Crf = clamp<int>(crf, 4, 63);
+		ctx.bit_rate = llround(ctx.width * ctx.height * av_q2d(ctx.framerate) / 4);
+		ctx.qmin = max(vp8Crf - 2, 4);
+		ctx.qmax = min(vp8Crf + 2, 63);
+
+		check_av_result(av_opt_set_int(ctx.priv_data, "crf", vp8Crf, 0));
+		check_av_result(av_opt_set(ctx.priv_data, "deadline", deadline, 0));
+
+		// VP8's realtime speed scale runs twice as far as VP9's
+		check_av_result(av_opt_set_int(ctx.priv_data, "cpu-used", realtime ? speed * 2 : speed, 0));
+		check_av_result(av_opt_set_int(ctx.priv_data, "lag-in-frames", draft || realtime ? 0 : 25, 0));
+		check_av_result(av_opt_set_int(ctx.priv_data, "auto-alt-ref", draft || realtime ? 0 : 1, 0));
+		if (!draft && !realtime)
+		{
+			check_av_result(av_opt_set_int(ctx.priv_data, "arnr-maxframes", 7, 0));
+			check_av_result(av_opt_set_int(ctx.priv_data, "arnr-strength", 4, 0));
+		}
+		break;
+	}
+	case FFmpegControllerOutputType::Vp9:
+	{
+		// crf, bitrate = 0, speed from the preset (lower better), row-mt 1
+		auto [deadline, speed] = GetVpxDeadlineAndSpeed(preset);
+
+		ctx.bit_rate = 0;
+		ctx.qmin = max(crf - 2, 0);
+		ctx.qmax = crf + 2;
+		ctx.qcompress = 1;
+
+		check_av_result(av_opt_set_int(ctx.priv_data, "crf", crf, 0));
+		check_av_result(av_opt_set(ctx.priv_data, "deadline", deadline, 0));
+		check_av_result(av_opt_set_int(ctx.priv_data, "cpu-used", speed, 0));
+		check_av_result(av_opt_set_int(ctx.priv_data, "row-mt", 1, 0));
+		check_av_result(av_opt_set_int(ctx.priv_data, "lag-in-frames", draft ? 0 : 25, 0));
+		check_av_result(av_opt_set_int(ctx.priv_data, "auto-alt-ref", draft ? 0 : 1, 0));
+		if (!draft)
+		{
+			check_av_result(av_opt_set_int(ctx.priv_data, "arnr-maxframes", 7, 0));
+			check_av_result(av_opt_set_int(ctx.priv_data, "arnr-strength", 4, 0));
+		}
+		check_av_result(av_opt_set_int(ctx.priv_data, "aq-mode", draft ? 0 : 4, 0));
+		check_av_result(av_opt_set_int(ctx.priv_data, "tile-columns", 6, 0));
+		check_av_result(av_opt_set_int(ctx.priv_data, "tile-rows", 2, 0));
+		break;
+	}
+	case FFmpegControllerOutputType::Av1:
+	{
+		// tiles are what both encoders thread over, so size them to the frame: log2 columns and rows
+		auto tileColumns = ctx.width >= 3840 ? 2 : ctx.width >= 1920 ? 1 : 0;
+		auto tileRows = ctx.height >= 2160 ? 1 : 0;
+		auto svt = string_view{ ctx.codec->name } == "libsvtav1";
+
+		check_av_result(av_opt_set_int(ctx.priv_data, "crf", min(crf, 63u), 0));
+		if (svt)
+		{
+			check_av_result(av_opt_set_int(ctx.priv_data, "preset", GetAv1Speed(preset, true), 0));
+			check_av_result(av_opt_set(ctx.priv_data, "svtav1-params",
+				format("tile-columns={}:tile-rows={}:lp={}", tileColumns, tileRows, ctx.thread_count).c_str(), 0));
+		}
+		else
+		{
+			check_av_result(av_opt_set_int(ctx.priv_data, "cpu-used", GetAv1Speed(preset, false), 0));
+			check_av_result(av_opt_set_int(ctx.priv_data, "row-mt", 1, 0));
+			check_av_result(av_opt_set_int(ctx.priv_data, "tile-columns", tileColumns, 0));
+			check_av_result(av_opt_set_int(ctx.priv_data, "tile-rows", tileRows, 0));
+			if (draft && rateControlMode != FFmpegControllerRateControlMode::TwoPass)
+				check_av_result(av_opt_set(ctx.priv_data, "usage", "realtime", 0));
+		}
+		break;
+	}
+	}
+
+	SetupRateControl(ctx, outputType);
+}
+
+void FFmpegController::SetupRateControl(AVCodecContext& ctx, FFmpegControllerOutputType outputType)
+{
+	int ret;
+
+	if (rateControlMode == FFmpegControllerRateControlMode::Crf)
+		return;
+	if (!bitrateKbps)
+		throw invalid_argument("Bitrate rate control needs a bitrate.");
+
+	auto bitRate = int64_t{ bitrateKbps } * 1000;
+	auto codecName = string_view{ ctx.codec->name };
+	auto vpxOrAom = codecName == "libvpx" || codecName == "libvpx-vp9" || codecName == "libaom-av1";
+
+	if (rateControlMode == FFmpegControllerRateControlMode::Vbv)
+	{
+		// keep the CRF, capped over a two second buffer; libvpx and libaom have no capped CRF,
+		// their constrained quality mode takes the cap as its target bitrate instead
+		ctx.rc_max_rate = bitRate;
+		ctx.rc_buffer_size = static_cast<int>(min<int64_t>(bitRate * 2, INT_MAX));
+		if (vpxOrAom)
+		{
+			ctx.bit_rate = bitRate;
+
+			// the VP8/VP9 quantizer window around the CRF would stop the encoder from going coarse enough to meet the cap
+			if (ctx.qmax > 0)
+				ctx.qmax = 63;
+		}
+		return;
+	}
+
+	// two pass, the average bitrate alone: a CRF or quantizer bounds would override it
+	ctx.bit_rate = bitRate;
+	ctx.qmin = ctx.qmax = -1;
+	check_av_result(av_opt_set_int(ctx.priv_data, "crf", -1, 0));
+
+	if (encodingPass == 2 && !twoPassStats.empty())
+	{
+		ctx.stats_in = av_strdup(twoPassStats.c_str());
+		check_av_pointer(ctx.stats_in);
+	}
+	ctx.flags |= encodingPass == 1 ? AV_CODEC_FLAG_PASS1 : AV_CODEC_FLAG_PASS2;
+
+	switch (outputType)
+	{
+	case FFmpegControllerOutputType::Mp4:
+		// x264 already runs a fast first pass unless told otherwise
+		check_av_result(av_opt_set(ctx.priv_data, "stats", twoPassStatsFilenameUtf8.c_str(), 0));
+		break;
+	case FFmpegControllerOutputType::Mp4Hevc:
+		// the FFmpeg wrapper doesn't pass the pass flags through to x265, quoted for the drive letter's colon
+		AppendX265Params(ctx, format("pass={}:stats='{}'{}", encodingPass, twoPassStatsFilenameUtf8,
+			encodingPass == 1 ? ":slow-firstpass=0" : ""));
+		break;
+	}
+}
+
+MediaTime FFmpegController::GetDurationFromFrameNumber(int64_t frameNumber) const
+{
+	return MediaTimeFromSeconds(frameNumber / frameRate);
+}
+
+int64_t FFmpegController::GetFrameNumberFromDuration(MediaTime duration) const
+{
+	return llround(MediaTimeToSeconds(duration) * frameRate);
+}
+
+void FFmpegController::SetValidTrimmingRanges(const vector<FFmpegControllerTrimmingMarker>& trimmingMarkers)
+{
+	validTrimmingRanges.clear();
+
+	if (trimmingMarkers.empty())
+		validTrimmingRanges.push_back({ {}, mediaDuration });
+	else
+	{
+		// calculate the timespan of the first entry's frame number 
+		auto lastTimeSpan = GetDurationFromFrameNumber(trimmingMarkers[0].frameNumber);
+		for (auto i = 1; i < trimmingMarkers.size(); ++i)
+		{
+			auto timeSpan = GetDurationFromFrameNumber(trimmingMarkers[i].frameNumber);
+			if (!trimmingMarkers[i - 1].trimAfter)
+				validTrimmingRanges.push_back({ lastTimeSpan, timeSpan });
+			lastTimeSpan = timeSpan;
+		}
+
+		if (!trimmingMarkers.back().trimAfter)
+			validTrimmingRanges.push_back({ lastTimeSpan, mediaDuration });
+	}
+}
+
+void FFmpegController::SetValidTrimmingRange(MediaTime start, MediaTime end)
+{
+	validTrimmingRanges.clear();
+	validTrimmingRanges.push_back({ start, end });
+}
+
+int64_t FFmpegController::GetOutputFrameCount() const
+{
+	int64_t frameCount = 0;
+	for (auto& [rangeStart, rangeEnd] : validTrimmingRanges)
+		frameCount += GetFrameNumberFromDuration(rangeEnd) - GetFrameNumberFromDuration(rangeStart);
+	return frameCount;
+}
+
+vector<FFmpegControllerExportSegment> FFmpegController::GetExportSegments() const
+{
+	// split at every trimming range boundary, and at GOP-aligned output frames inside long ranges
+	const auto maxSegmentFrames = outputGopSize * exportSegmentGopCount;
+
+	vector<FFmpegControllerExportSegment> segments;
+	int64_t outputFrameOffset = 0;
+	for (auto& [rangeStart, rangeEnd] : validTrimmingRanges)
+	{
+		auto startFrameNumber = GetFrameNumberFromDuration(rangeStart);
+		auto endFrameNumber = GetFrameNumberFromDuration(rangeEnd);
+
+		for (auto frameNumber = startFrameNumber; frameNumber < endFrameNumber; frameNumber += maxSegmentFrames)
+		{
+			auto segmentEndFrameNumber = min(frameNumber + maxSegmentFrames, endFrameNumber);
+			segments.push_back({
+				frameNumber == startFrameNumber ? rangeStart : GetDurationFromFrameNumber(frameNumber),
+				segmentEndFrameNumber == endFrameNumber ? rangeEnd : GetDurationFromFrameNumber(segmentEndFrameNumber),
+				outputFrameOffset, segmentEndFrameNumber - frameNumber });
+			outputFrameOffset += segmentEndFrameNumber - frameNumber;
+		}
+	}
+
+	return segments;
+}
+
+vector<FFmpegControllerExportSegment> FFmpegController::GetSmartRenderSegments() const
+{
+	// keyframes in presentation order, as frame numbers
+	vector<int64_t> keyframeFrameNumbers;
+	keyframeFrameNumbers.reserve(keyframePacketIndices.size());
+	for (auto keyframePacketIndex : keyframePacketIndices)
+		keyframeFrameNumbers.push_back(GetFrameNumberFromPts(GetKeyframePresentationTimestamp(packetIndex[keyframePacketIndex])));
+	sort(keyframeFrameNumbers.begin(), keyframeFrameNumbers.end());
+
+	vector<FFmpegControllerExportSegment> segments;
+	int64_t outputFrameOffset = 0;
+	auto addSegment = [&](int64_t startFrameNumber, int64_t endFrameNumber, MediaTime start, MediaTime end, bool streamCopy)
+		{
+			if (endFrameNumber <= startFrameNumber)
+				return;
+
+			segments.push_back({ start, end, outputFrameOffset, endFrameNumber - startFrameNumber, streamCopy });
+			outputFrameOffset += endFrameNumber - startFrameNumber;
+		};
+
+	for (auto& [rangeStart, rangeEnd] : validTrimmingRanges)
+	{
+		auto startFrameNumber = GetFrameNumberFromDuration(rangeStart);
+		auto endFrameNumber = GetFrameNumberFromDuration(rangeEnd);
+
+		// whole GOPs inside the range are copied, only the partial GOPs at the cut points get re-encoded;
+		// the last GOP of the file is whole if the range runs to the end
+		auto firstKeyframe = lower_bound(keyframeFrameNumbers.begin(), keyframeFrameNumbers.end(), startFrameNumber);
+		auto afterLastKeyframe = upper_bound(keyframeFrameNumbers.begin(), keyframeFrameNumbers.end(), endFrameNumber);
+		if (firstKeyframe == afterLastKeyframe)
+		{
+			addSegment(startFrameNumber, endFrameNumber, rangeStart, rangeEnd, false);
+			continue;
+		}
+
+		auto copyStartFrameNumber = *firstKeyframe;
+		auto copyEndFrameNumber = rangeEnd >= mediaDuration ? endFrameNumber : *prev(afterLastKeyframe);
+		if (copyEndFrameNumber <= copyStartFrameNumber)
+		{
+			addSegment(startFrameNumber, endFrameNumber, rangeStart, rangeEnd, false);
+			continue;
+		}
+
+		auto copyStart = GetDurationFromFrameNumber(copyStartFrameNumber);
+		auto copyEnd = copyEndFrameNumber == endFrameNumber ? rangeEnd : GetDurationFromFrameNumber(copyEndFrameNumber);
+		addSegment(startFrameNumber, copyStartFrameNumber, rangeStart, copyStart, false);
+		addSegment(copyStartFrameNumber, copyEndFrameNumber, copyStart, copyEnd, true);
+		addSegment(copyEndFrameNumber, endFrameNumber, copyEnd, rangeEnd, false);
+	}
+
+	return segments;
+}
+
+bool FFmpegController::CanStreamCopy(FFmpegControllerOutputType outputType, uint32_t width, uint32_t height,
+	const vector<FFmpegControllerCropFrame>& cropFrames) const
+{
+	auto sourceWidth = inputVideoStream->codecpar->width;
+	auto sourceHeight = inputVideoStream->codecpar->height;
+
+	if (keyframePacketIndices.empty() || frameRateMultiplier != 1
+		|| inputVideoStream->codecpar->codec_id != GetCodecId(outputType)
+		|| width != static_cast<uint32_t>(sourceWidth) || height != static_cast<uint32_t>(sourceHeight))
+	{
+		return false;
+	}
+
+	// the crop has to be the full frame throughout
+	return all_of(cropFrames.begin(), cropFrames.end(), [&](auto& cropFrame)
+		{
+			auto& cropRectangle = cropFrame.cropRectangle;
+			return cropRectangle.width == sourceWidth && cropRectangle.height == sourceHeight
+				&& cropRectangle.centerX - cropRectangle.width / 2 == 0 && cropRectangle.centerY - cropRectangle.height / 2 == 0;
+		});
+}
+
+void FFmpegController::StreamCopySegment(MediaTime start, MediaTime end, const char* filenameUtf8, const char* encoderTitleUtf8)
+{
+	int ret;
+
+	auto startKeyframe = FindSeekKeyframe(GetPtsFromFrameNumber(GetFrameNumberFromDuration(start)));
+	check_av_pointer(startKeyframe);
+	auto endDts = end >= mediaDuration ? INT64_MAX
+		: FindSeekKeyframe(GetPtsFromFrameNumber(GetFrameNumberFromDuration(end)))->dts;
+
+	AutoReleasePtr<AVFormatContext, avformat_free_context> copyFormatContext;
+	check_av_result(avformat_alloc_output_context2(&copyFormatContext, nullptr, nullptr, filenameUtf8));
+	copyFormatContext->avoid_negative_ts = AVFMT_AVOID_NEG_TS_MAKE_NON_NEGATIVE;
+	check_av_result(av_dict_set(&copyFormatContext->metadata, "encoder-app", encoderTitleUtf8, 0));
+
+	// the concatenated output keeps a single segment's extradata, so the parameter sets travel in-band with every keyframe
+	auto codecId = inputVideoStream->codecpar->codec_id;
+	auto bsf = av_bsf_get_by_name(codecId == AV_CODEC_ID_H264 ? "h264_mp4toannexb" : codecId == AV_CODEC_ID_HEVC ? "hevc_mp4toannexb" : "null");
+	check_av_pointer(bsf);
+
+	AutoReleasePtr<AVBSFContext, av_bsf_free> bsfContext;
+	check_av_result(av_bsf_alloc(bsf, &bsfContext));
+	check_av_result(avcodec_parameters_copy(bsfContext->par_in, inputVideoStream->codecpar));
+	bsfContext->time_base_in = inputVideoStream->time_base;
+	check_av_result(av_bsf_init(&*bsfContext));
+
+	AVStream* copyVideoStream{};
+	check_av_pointer(copyVideoStream = avformat_new_stream(&*copyFormatContext, nullptr));
+	check_av_result(avcodec_parameters_copy(copyVideoStream->codecpar, bsfContext->par_out));
+	copyVideoStream->codecpar->codec_tag = GetRemuxCodecTag(*copyFormatContext, *copyVideoStream->codecpar);
+	copyVideoStream->time_base = bsfContext->time_base_out;
+
+	if (!(copyFormatContext->oformat->flags & AVFMT_NOFILE))
+		check_av_result(avio_open(&copyFormatContext->pb, filenameUtf8, AVIO_FLAG_WRITE));
+	check_av_result(avformat_write_header(&*copyFormatContext, nullptr));
+
+	avcodec_flush_buffers(&*inputCodecContext);
+	check_av_result(av_seek_frame(&*inputFormatContext, inputVideoStream->index, startKeyframe->dts, AVSEEK_FLAG_BACKWARD));
+
+	AutoReleasePtr<AVPacket, av_packet_free> packet = av_packet_alloc();
+	check_av_pointer(packet);
+
+	auto writeFilteredPackets = [&]
+		{
+			while ((ret = av_bsf_receive_packet(&*bsfContext, &*packet)) >= 0)
+			{
+				av_packet_rescale_ts(&*packet, bsfContext->time_base_out, copyVideoStream->time_base);
+				packet->stream_index = copyVideoStream->index;
+				packet->pos = -1;
+				check_av_result(av_interleaved_write_frame(&*copyFormatContext, &*packet));
+			}
+			if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+				check_av_result(ret);
+		};
+
+	// every packet from the start keyframe up to, but not including, the keyframe the next segment starts with
+	while ((ret = av_read_frame(&*inputFormatContext, &*packet)) >= 0)
+	{
+		if (packet->stream_index != inputVideoStream->index || packet->dts < startKeyframe->dts)
+		{
+			av_packet_unref(&*packet);
+			continue;
+		}
+		if (packet->dts >= endDts)
+		{
+			av_packet_unref(&*packet);
+			break;
+		}
+
+		check_av_result(av_bsf_send_packet(&*bsfContext, &*packet));
+		writeFilteredPackets();
+	}
+	if (ret < 0 && ret != AVERROR_EOF)
+		check_av_result(ret);
+
+	check_av_result(av_bsf_send_packet(&*bsfContext, nullptr));
+	writeFilteredPackets();
+
+	check_av_result(av_write_trailer(&*copyFormatContext));
+	if (!(copyFormatContext->oformat->flags & AVFMT_NOFILE))
+		check_av_result(avio_closep(&copyFormatContext->pb));
+}
+
+void FFmpegController::OpenEncoder(FFmpegControllerOutputVideo& outputVideo, AVFormatContext& formatContext,
+	FFmpegControllerOutputType outputType, uint32_t crf, FFmpegControllerPresetType preset, uint32_t width, uint32_t height)
+{
+	int ret;
+
+	auto& outputCodecContext = outputVideo.codecContext;
+	auto& outputVideoStream = outputVideo.videoStream;
+
+	// build the codec
+	auto outputCodec = FindEncoder(outputType, rateControlMode == FFmpegControllerRateControlMode::TwoPass);
+	check_av_pointer(outputCodec);
+
+	check_av_pointer(outputCodecContext = avcodec_alloc_context3(outputCodec));
+
+	outputCodecContext->width = width;
+	outputCodecContext->height = height;
+	// one tick per output frame, so the rate control's idea of frame duration matches what's played back
+	outputCodecContext->framerate = av_mul_q(inputCodecContext->framerate, av_d2q(frameRateMultiplier, INT_MAX));
+	outputCodecContext->time_base = av_inv_q(outputCodecContext->framerate);
+
+	SetupEncodingParameters(*outputCodecContext, outputType, crf, preset);
+	if (matchSourceEncoding)
+	{
+		outputCodecContext->profile = inputCodecContext->profile;
+		outputCodecContext->level = inputCodecContext->level;
+		outputCodecContext->color_range = inputCodecContext->color_range;
+		outputCodecContext->color_primaries = inputCodecContext->color_primaries;
+		outputCodecContext->color_trc = inputCodecContext->color_trc;
+		outputCodecContext->colorspace = inputCodecContext->colorspace;
+
+		if (outputType == FFmpegControllerOutputType::Mp4)
+			check_av_result(av_opt_set(outputCodecContext->priv_data, "x264-params", "repeat-headers=1", 0));
+		else if (outputType == FFmpegControllerOutputType::Mp4Hevc)
+			AppendX265Params(*outputCodecContext, "repeat-headers=1");
+	}
+	outputCodecContext->gop_size = keyframePlan.gopSize ? keyframePlan.gopSize : outputGopSize;
+
+	if (onlyPlannedKeyframes)
+	{
+		// no keyframes of the encoder's own choosing, its fixed interval never runs out between two planned ones
+		outputCodecContext->keyint_min = outputCodecContext->gop_size;
+		if (outputType == FFmpegControllerOutputType::Mp4)
+			AppendCodecParams(*outputCodecContext, "x264-params", "scenecut=0");
+		else if (outputType == FFmpegControllerOutputType::Mp4Hevc)
+			AppendX265Params(*outputCodecContext, "scenecut=0");
+		else if (string_view{ outputCodec->name } == "libsvtav1")
+			AppendCodecParams(*outputCodecContext, "svtav1-params", "scd=0");
+	}
+
+	// keep the source pixel format when the encoder takes it (VP8 only does 4:2:0 8-bit)
+	outputCodecContext->pix_fmt = outputCodec->pix_fmts
+		? avcodec_find_best_pix_fmt_of_list(outputCodec->pix_fmts, inputCodecContext->pix_fmt, 0, nullptr)
+		: inputCodecContext->pix_fmt;
+	outputCodecContext->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+
+	if (formatContext.oformat->flags & AVFMT_GLOBALHEADER)
+		outputCodecContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+	check_av_result(avcodec_open2(&*outputCodecContext, outputCodec, nullptr));
+
+	// video stream
+	check_av_pointer(outputVideoStream = avformat_new_stream(&formatContext, nullptr));
+
+	check_av_result(avcodec_parameters_from_context(outputVideoStream->codecpar, &*outputCodecContext));
+	outputVideoStream->time_base = outputCodecContext->time_base;
+}
+
+void FFmpegController::OpenOutputVideo(const char* filenameUtf8, FFmpegControllerOutputType outputType, uint32_t crf, FFmpegControllerPresetType preset,
+	uint32_t width, uint32_t height, const char* encoderTitleUtf8,
+	const vector<FFmpegControllerCropFrame>& cropFrames,
+	bool dumpFormat)
+{
+	int ret;
+
+	// the statistics file and buffer belong to a single encoder
+	if (rateControlMode == FFmpegControllerRateControlMode::TwoPass && !outputVideos.empty())
+		throw invalid_argument("Two pass encodes only take a single output.");
+	if (ladderFormatContext)
+		throw invalid_argument("A ladder doesn't share its decode with other outputs.");
+
+	// only added once it's fully open, the destructor finishes every added output
+	auto outputVideoRef = make_unique<FFmpegControllerOutputVideo>();
+	auto& outputFormatContext = outputVideoRef->formatContext;
+
+	// the analysis pass only feeds the encoder's statistics, its packets go nowhere
+	check_av_result(avformat_alloc_output_context2(&outputFormatContext, nullptr, encodingPass == 1 ? "null" : nullptr, filenameUtf8));
+	outputFormatContext->avoid_negative_ts = AVFMT_AVOID_NEG_TS_MAKE_NON_NEGATIVE;
+	check_av_result(av_dict_set(&outputFormatContext->metadata, "encoder-app", encoderTitleUtf8, 0));
+
+	OpenEncoder(*outputVideoRef, *outputFormatContext, outputType, crf, preset, width, height);
+
+	if (dumpFormat)
+		av_dump_format(&*outputFormatContext, 0, filenameUtf8, 1);
+
+	// open the output file
+	if (!(outputFormatContext->oformat->flags & AVFMT_NOFILE))
+		check_av_result(avio_open(&outputFormatContext->pb, filenameUtf8, AVIO_FLAG_WRITE));
+	if ((ret = avformat_write_header(&*outputFormatContext, nullptr)) < 0)
+	{
+		avio_closep(&outputFormatContext->pb);
+		throw_av_error(ret);
+	}
+
+	outputVideos.push_back(move(outputVideoRef));
+	this->cropFrames = cropFrames;
+}
+
+void FFmpegController::OpenOutputLadder(const char* manifestFilenameUtf8, FFmpegControllerOutputType outputType, FFmpegControllerPresetType preset,
+	const vector<FFmpegControllerRendition>& renditions, MediaTime segmentDuration, const char* encoderTitleUtf8,
+	const vector<FFmpegControllerCropFrame>& cropFrames, bool dumpFormat)
+{
+	int ret;
+
+	if (renditions.empty())
+		throw invalid_argument("A ladder needs at least one rendition.");
+	if (!outputVideos.empty() || ladderFormatContext)
+		throw invalid_argument("A ladder doesn't share its decode with other outputs.");
+	if (rateControlMode == FFmpegControllerRateControlMode::TwoPass)
+		throw invalid_argument("Ladders are encoded in a single pass.");
+
+	// a keyframe on every segment boundary, next to the scene cuts if the scenes were analyzed, and none anywhere
+	// else, so players can switch renditions at any segment
+	auto segmentFrameCount = max<int64_t>(1, llround(frameRate * frameRateMultiplier * MediaTimeToSeconds(segmentDuration)));
+	auto outputFrameCount = GetOutputFrameCount();
+	for (int64_t frameNumber = 0; frameNumber < outputFrameCount; frameNumber += segmentFrameCount)
+		keyframePlan.keyframeNumbers.push_back(frameNumber);
+	ranges::sort(keyframePlan.keyframeNumbers);
+	keyframePlan.keyframeNumbers.erase(ranges::unique(keyframePlan.keyframeNumbers).begin(), keyframePlan.keyframeNumbers.end());
+	keyframePlan.gopSize = static_cast<int>(segmentFrameCount);
+	onlyPlannedKeyframes = true;
+
+	// every rendition is a stream of the one DASH muxer, which writes a file per rendition and segment by itself
+	check_av_result(avformat_alloc_output_context2(&ladderFormatContext, nullptr, "dash", manifestFilenameUtf8));
+	check_av_result(av_dict_set(&ladderFormatContext->metadata, "encoder-app", encoderTitleUtf8, 0));
+
+	// each rendition's own CRF, capped at its bitrate when it has one
+	auto ladderRateControlMode = rateControlMode;
+	auto ladderBitrateKbps = bitrateKbps;
+	vector<unique_ptr<FFmpegControllerOutputVideo>> ladderOutputVideos;
+	for (auto& rendition : renditions)
+	{
+		SetRateControl(rendition.maxBitrateKbps ? FFmpegControllerRateControlMode::Vbv : FFmpegControllerRateControlMode::Crf, rendition.maxBitrateKbps);
+
+		auto& outputVideo = *ladderOutputVideos.emplace_back(make_unique<FFmpegControllerOutputVideo>());
+		OpenEncoder(outputVideo, *ladderFormatContext, outputType, rendition.crf, preset, rendition.width, rendition.height);
+
+		// the manifest's bandwidth, which a CRF encode only knows once its first segment is written
+		if (rendition.maxBitrateKbps)
+			outputVideo.videoStream->codecpar->bit_rate = int64_t{ rendition.maxBitrateKbps } * 1000;
+	}
+	SetRateControl(ladderRateControlMode, ladderBitrateKbps);
+
+	// VP8, VP9 and AV1 go in WebM, which HLS doesn't take, the MP4 flavors get an HLS master playlist next to the manifest
+	auto webm = outputType == FFmpegControllerOutputType::Vp8 || outputType == FFmpegControllerOutputType::Vp9
+		|| outputType == FFmpegControllerOutputType::Av1;
+
+	AVDictionary* options{};
+	av_dict_set(&options, "seg_duration", format("{}", MediaTimeToSeconds(segmentDuration)).c_str(), 0);
+	av_dict_set(&options, "dash_segment_type", webm ? "webm" : "mp4", 0);
+	av_dict_set(&options, "adaptation_sets", "id=0,streams=v", 0);
+	av_dict_set(&options, "use_template", "1", 0);
+	av_dict_set(&options, "use_timeline", "1", 0);
+	av_dict_set(&options, "hls_playlist", webm ? "0" : "1", 0);
+
+	if (dumpFormat)
+		av_dump_format(&*ladderFormatContext, 0, manifestFilenameUtf8, 1);
+
+	ret = avformat_write_header(&*ladderFormatContext, &options);
+	av_dict_free(&options);
+	check_av_result(ret);
+
+	for (auto& outputVideo : ladderOutputVideos)
+		outputVideos.push_back(move(outputVideo));
+	this->cropFrames = cropFrames;
+}
+
+FFmpegControllerCropRectangle FFmpegController::GetCurrentCropRectangle()
+{
+	auto& cropFrame = cropFrames[cropFrameEntryIndex];
+	assert(filteredFrameNumber >= cropFrame.frameNumber);
+
+	if (cropFrameEntryIndex == cropFrames.size() - 1)
+		return cropFrame.cropRectangle;
+
+	auto& nextCropFrame = cropFrames[cropFrameEntryIndex + 1];
+	assert(filteredFrameNumber < nextCropFrame.frameNumber);
+
+	auto f = (double)(filteredFrameNumber - cropFrame.frameNumber) / (nextCropFrame.frameNumber - cropFrame.frameNumber);
+	auto center_x = cropFrame.cropRectangle.centerX + f * (nextCropFrame.cropRectangle.centerX - cropFrame.cropRectangle.centerX);
+	auto center_y = cropFrame.cropRectangle.centerY + f * (nextCropFrame.cropRectangle.centerY - cropFrame.cropRectangle.centerY);
+	auto width = cropFrame.cropRectangle.width + f * (nextCropFrame.cropRectangle.width - cropFrame.cropRectangle.width);
+	auto height = cropFrame.cropRectangle.height + f * (nextCropFrame.cropRectangle.height - cropFrame.cropRectangle.height);
+
+	return { (int)center_x, (int)center_y, (int)width, (int)height };
+}
+
+asyncpp::generator<AVFrame*> FFmpegController::EnumerateInputFrames()
+{
+	int ret;
+
+	AutoReleasePtr<AVFrame, av_frame_free> inputFrame = av_frame_alloc();
+	flushing = false;
+	validTrimmingRangeEntryIndex = 0;
+
+	while (!flushing)
+	{
+		// end?
+		if (validTrimmingRangeEntryIndex >= validTrimmingRanges.size())
+			goto end;
+
+		if ((ret = av_read_frame(&*inputFormatContext, &*inputPacket)) < 0)
+			break;
+
+		if (inputPacket->stream_index == inputVideoStream->index)
+		{
+			if ((ret = avcodec_send_packet(&*inputCodecContext, &*inputPacket)) < 0)
+				break;
+
+		process_flushed_frames:
+			while (ret >= 0)
+			{
+				ret = avcodec_receive_frame(&*inputCodecContext, &*inputFrame);
+				if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+					break;
+				check_av_result(ret);
+
+				inputFrame->pts = inputFrame->best_effort_timestamp;
+
+				// handle trimming, in frame numbers so every range yields exactly its frames [start, end), the same
+				// ones GetOutputFrameCount and the export segments count
+				auto frameNumber = inputFrameNumber++;
+				while (validTrimmingRangeEntryIndex < validTrimmingRanges.size()
+					&& frameNumber >= GetFrameNumberFromDuration(validTrimmingRanges[validTrimmingRangeEntryIndex].second))
+				{
+					++validTrimmingRangeEntryIndex;
+				}
+
+				// past the end of the last range, nothing after it is worth decoding (a segment worker would
+				// otherwise read on to the end of the file)
+				if (validTrimmingRangeEntryIndex >= validTrimmingRanges.size())
+				{
+					av_packet_unref(&*inputPacket);
+					goto end;
+				}
+
+				if (auto startFrameNumber = GetFrameNumberFromDuration(validTrimmingRanges[validTrimmingRangeEntryIndex].first);
+					frameNumber < startFrameNumber)
+				{
+					// seek, frame-exact from the packet index when there is one, so parallel segments starting mid-range
+					// neither repeat nor skip the frames at their boundaries
+					SeekToFrame(startFrameNumber);
+					continue;
+				}
+
+				// yield the frame
+				co_yield &*inputFrame;
+			}
+		}
+
+		av_packet_unref(&*inputPacket);
+	}
+
+	// start flushing
+	if (!flushing)
+	{
+		// flush stuff
+		avcodec_send_packet(&*inputCodecContext, nullptr);
+		ret = 0;
+		flushing = true;
+		goto process_flushed_frames;
+	}
+
+	// yield a flush point to let any consuming filter graph work while all variables are still alive
+	// after this continuation point, everything is dead
+end:
+	co_yield nullptr;
+}
+
+void FFmpegController::EncodeFrame(AVFrame* frame)
+{
+	FilterFrame(frame, [&](size_t outputIndex, AVFrame* filteredFrame) { EncodeFilteredFrame(outputIndex, filteredFrame); });
+}
+
+void FFmpegController::FilterFrame(AVFrame* frame, const function<void(size_t outputIndex, AVFrame*)>& filteredFrameCallback)
+{
+	int ret;
+
+	if (!frame)
+	{
+		// flushing the encoders, the crop stage doesn't hold on to any frames
+		for (size_t outputIndex = 0; outputIndex < outputVideos.size(); ++outputIndex)
+			filteredFrameCallback(outputIndex, nullptr);
+		return;
+	}
+
+	// handle cropping
+	while (cropFrameEntryIndex < cropFrames.size() - 1 && filteredFrameNumber >= cropFrames[cropFrameEntryIndex + 1].frameNumber)
+		++cropFrameEntryIndex;
+	auto cropRectangle = GetCurrentCropRectangle();
+
+	auto pixelFormat = (AVPixelFormat)frame->format;
+	auto pixelFormatDescriptor = av_pix_fmt_desc_get(pixelFormat);
+	check_av_pointer(pixelFormatDescriptor);
+
+	// clamp the crop to the frame, with the origin aligned to the chroma subsampling
+	auto cropWidth = clamp(cropRectangle.width, 1, frame->width);
+	auto cropHeight = clamp(cropRectangle.height, 1, frame->height);
+	auto cropX = clamp(cropRectangle.centerX - cropRectangle.width / 2, 0, frame->width - cropWidth);
+	auto cropY = clamp(cropRectangle.centerY - cropRectangle.height / 2, 0, frame->height - cropHeight);
+	cropX &= ~((1 << pixelFormatDescriptor->log2_chroma_w) - 1);
+	cropY &= ~((1 << pixelFormatDescriptor->log2_chroma_h) - 1);
+
+	// crop by offsetting the plane pointers, no copy involved
+	int maxPixelSteps[4];
+	av_image_fill_max_pixsteps(maxPixelSteps, nullptr, pixelFormatDescriptor);
+
+	const uint8_t* croppedData[4]{};
+	for (int plane = 0; plane < 4 && frame->data[plane]; ++plane)
+	{
+		if (plane > 0 && (pixelFormatDescriptor->flags & AV_PIX_FMT_FLAG_PAL))
+		{
+			// palette, not an image plane
+			croppedData[plane] = frame->data[plane];
+			continue;
+		}
+
+		auto isChromaPlane = plane == 1 || plane == 2;
+		auto planeX = isChromaPlane ? cropX >> pixelFormatDescriptor->log2_chroma_w : cropX;
+		auto planeY = isChromaPlane ? cropY >> pixelFormatDescriptor->log2_chroma_h : cropY;
+		croppedData[plane] = frame->data[plane] + planeY * frame->linesize[plane] + planeX * maxPixelSteps[plane];
+	}
+
+	// the same keyframes in every output
+	auto pictureType = binary_search(keyframePlan.keyframeNumbers.begin(), keyframePlan.keyframeNumbers.end(), filteredFrameNumber)
+		? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+	++filteredFrameNumber;
+
+	// resample the one crop straight into each output's frame
+	for (size_t outputIndex = 0; outputIndex < outputVideos.size(); ++outputIndex)
+	{
+		auto& outputCodecContext = outputVideos[outputIndex]->codecContext;
+		auto& filteredFrame = outputVideos[outputIndex]->filteredFrame;
+
+		filteredFrame->format = outputCodecContext->pix_fmt;
+		filteredFrame->width = outputCodecContext->width;
+		filteredFrame->height = outputCodecContext->height;
+		check_av_result(av_frame_get_buffer(&*filteredFrame, 0));
+		check_av_result(av_frame_copy_props(&*filteredFrame, frame));
+
+		auto swsContext = cropScalerCache.Get({ cropWidth, cropHeight, pixelFormat,
+			outputCodecContext->width, outputCodecContext->height, outputCodecContext->pix_fmt, SWS_BICUBIC });
+		check_av_result(sws_scale(swsContext,
+			croppedData, frame->linesize, 0, cropHeight, filteredFrame->data, filteredFrame->linesize));
+
+		filteredFrame->time_base = inputCodecContext->pkt_timebase;
+		filteredFrame->sample_aspect_ratio = { 1, 1 };
+		filteredFrame->pict_type = pictureType;
+
+		filteredFrameCallback(outputIndex, &*filteredFrame);
+
+		av_frame_unref(&*filteredFrame);
+	}
+}
+
+FFmpegControllerKeyframePlan FFmpegController::AnalyzeScenes()
+{
+	int ret;
+
+	// frames are compared as tiny grayscale thumbnails, a cut has to stand out both from an absolute floor and
+	// from the recent motion, and cuts closer together than half a second are flashes
+	constexpr int analysisWidth = 64, analysisHeight = 36;
+	constexpr double cutMinimumDifference = 12, cutMotionFactor = 4;
+
+	// content whose frames barely change (slides, screen captures) gets long GOPs, everything else short ones for seeking
+	constexpr double staticMaximumDifference = 1;
+	constexpr double staticGopSeconds = 10, gopSeconds = 4;
+
+	SetSkipLoopFilter(true);
+
+	FFmpegControllerKeyframePlan plan;
+	vector<uint8_t> previousThumbnail(analysisWidth * analysisHeight), thumbnail(analysisWidth * analysisHeight);
+	auto minimumCutDistance = max<int64_t>(1, llround(frameRate / 2));
+	int64_t frameNumber = 0, lastKeyframeNumber = 0, comparedFrameCount = 0;
+	double averageDifference = 0, totalDifference = 0;
+	int trimmingRangeIndex = -1;
+
+	for (auto frame : EnumerateInputFrames())
+	{
+		if (!frame)
+			break;
+		++pipelineStats->decodedFrameCount;
+
+		auto swsContext = cropScalerCache.Get({ frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+			analysisWidth, analysisHeight, AV_PIX_FMT_GRAY8, SWS_AREA });
+		uint8_t* thumbnailData[4]{ thumbnail.data() };
+		int thumbnailLinesize[4]{ analysisWidth };
+		check_av_result(sws_scale(swsContext, frame->data, frame->linesize, 0, frame->height, thumbnailData, thumbnailLinesize));
+
+		// every trimming range starts on a keyframe, and its first frame isn't comparable to the previous range's last
+		auto keyframe = validTrimmingRangeEntryIndex != trimmingRangeIndex;
+		if (!keyframe)
+		{
+			// mean absolute difference
+			int64_t differenceSum = 0;
+			for (size_t i = 0; i < thumbnail.size(); ++i)
+				differenceSum += abs(thumbnail[i] - previousThumbnail[i]);
+			auto difference = static_cast<double>(differenceSum) / thumbnail.size();
+
+			keyframe = difference > cutMinimumDifference && difference > averageDifference * cutMotionFactor
+				&& frameNumber - lastKeyframeNumber >= minimumCutDistance;
+
+			averageDifference = averageDifference * 0.9 + difference * 0.1;
+			totalDifference += difference;
+			++comparedFrameCount;
+		}
+
+		if (keyframe)
+		{
+			plan.keyframeNumbers.push_back(frameNumber);
+			lastKeyframeNumber = frameNumber;
+		}
+
+		trimmingRangeIndex = validTrimmingRangeEntryIndex;
+		swap(previousThumbnail, thumbnail);
+		++frameNumber;
+	}
+
+	auto isStatic = comparedFrameCount && totalDifference / comparedFrameCount < staticMaximumDifference;
+	plan.gopSize = static_cast<int>(max<int64_t>(1, llround(frameRate * (isStatic ? staticGopSeconds : gopSeconds))));
+
+	av_log(nullptr, AV_LOG_INFO, "Scene analysis: %zu keyframes in %lld frames, %s content, GOP of %d frames.\n",
+		plan.keyframeNumbers.size(), frameNumber, isStatic ? "static" : "moving", plan.gopSize);
+	return plan;
+}
+
+void FFmpegController::EncodeFilteredFrame(size_t outputIndex, AVFrame* frame)
+{
+	int ret;
+
+	auto& outputVideo = *outputVideos[outputIndex];
+	auto& outputCodecContext = outputVideo.codecContext;
+	auto& outputPacket = outputVideo.packet;
+	auto& encodedFrameNumber = outputVideo.encodedFrameNumber;
+
+	av_packet_unref(&*outputPacket);
+
+	if (frame && frame->pts != AV_NOPTS_VALUE)
+	{
+		if (!encodedFrameNumber)
+			outputVideo.encodeStartTime = steady_clock::now();
+		++pipelineStats->encodedFrameCount;
+
+		// in the codec's time base, the packets are rescaled to the muxer's below
+		frame->pts = encodedFrameNumber++;
+	}
+
+	ret = avcodec_send_frame(&*outputCodecContext, frame);
+	while (ret >= 0)
+	{
+		ret = avcodec_receive_packet(&*outputCodecContext, &*outputPacket);
+		if (ret == AVERROR_EOF && encodedFrameNumber)
+		{
+			// fully flushed
+			auto seconds = duration<double>(steady_clock::now() - outputVideo.encodeStartTime).count();
+			av_log(nullptr, AV_LOG_INFO, "Encoded %lld frames with %s in %.1fs, %.1f fps.\n",
+				encodedFrameNumber, outputCodecContext->codec->name, seconds, encodedFrameNumber / max(seconds, 1e-3));
+		}
+		if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+			return;
+		check_av_result(ret);
+
+		if (encodingPass != 1)
+			pipelineStats->bytesWritten += outputPacket->size;
+
+		// muxers pick their own stream time base when writing the header (1/1000 for WebM, a multiple of the frame rate for MP4)
+		av_packet_rescale_ts(&*outputPacket, outputCodecContext->time_base, outputVideo.videoStream->time_base);
+
+		if (outputVideo.formatContext)
+		{
+			outputPacket->stream_index = 0;
+			check_av_result(av_interleaved_write_frame(&*outputVideo.formatContext, &*outputPacket));
+		}
+		else
+		{
+			// ladder renditions share the DASH muxer, which keeps a file per stream so nothing needs interleaving
+			outputPacket->stream_index = outputVideo.videoStream->index;
+			lock_guard lock(ladderMutex);
+			check_av_result(av_write_frame(&*ladderFormatContext, &*outputPacket));
+		}
+	}
+}
+
+void FFmpegController::RunEncodingPipeline(const function<void(AVFrame*)>& inputFrameCallback)
+{
+	// demux + decode run on the calling thread, crop + scale gets its own thread, and so does encode + mux for each
+	// output, with refcounted frames handed between them through bounded queues
+	using FrameRef = AutoReleasePtr<AVFrame, av_frame_free>;
+	BoundedQueue<FrameRef> decodedFrames(pipelineQueueCapacity);
+	vector<unique_ptr<BoundedQueue<FrameRef>>> filteredFrames;
+	for (size_t outputIndex = 0; outputIndex < outputVideos.size(); ++outputIndex)
+		filteredFrames.push_back(make_unique<BoundedQueue<FrameRef>>(pipelineQueueCapacity));
+	exception_ptr filterException, encodeException;
+	mutex encodeExceptionMutex;
+	atomic<bool> aborted{};
+
+	// after a failure in any stage, so no encoder flushes a partial output as if it were complete
+	auto abortPipeline = [&]
+		{
+			aborted = true;
+			for (auto& outputFilteredFrames : filteredFrames)
+				outputFilteredFrames->Abort();
+			decodedFrames.Abort();
+		};
+
+	vector<jthread> encodeThreads;
+	for (size_t outputIndex = 0; outputIndex < outputVideos.size(); ++outputIndex)
+		encodeThreads.emplace_back([&, outputIndex]
+			{
+				try
+				{
+					FrameRef frame;
+					while (filteredFrames[outputIndex]->Pop(frame))
+					{
+						--pipelineStats->filteredQueueDepth;
+						EncodeFilteredFrame(outputIndex, &*frame);
+					}
+
+					// the filter stage closes its queues only once it's done, so an empty queue here means flush,
+					// unless a stage failed and aborted the queues
+					if (!aborted)
+						EncodeFilteredFrame(outputIndex, nullptr);
+				}
+				catch (...)
+				{
+					{
+						lock_guard lock(encodeExceptionMutex);
+						if (!encodeException)
+							encodeException = current_exception();
+					}
+					abortPipeline();
+				}
+			});
+
+	jthread filterThread([&]
+		{
+			try
+			{
+				auto pushFilteredFrame = [&](size_t outputIndex, AVFrame* filteredFrame)
+					{
+						if (!filteredFrame)
+							return;
+
+						FrameRef frameRef = av_frame_clone(filteredFrame);
+						check_av_pointer(frameRef);
+						if (filteredFrames[outputIndex]->Push(move(frameRef)))
+							++pipelineStats->filteredQueueDepth;
+					};
+
+				FrameRef frame;
+				while (decodedFrames.Pop(frame))
+				{
+					--pipelineStats->decodedQueueDepth;
+					FilterFrame(&*frame, pushFilteredFrame);
+
+					// once per input frame, however many outputs it was cropped and scaled for
+					++pipelineStats->filteredFrameCount;
+				}
+				for (auto& outputFilteredFrames : filteredFrames)
+					outputFilteredFrames->Close();
+			}
+			catch (...)
+			{
+				filterException = current_exception();
+				abortPipeline();
+			}
+		});
+
+	try
+	{
+		for (auto frame : EnumerateInputFrames())
+		{
+			// flush point, everything was decoded
+			if (!frame)
+				break;
+
+			inputFrameCallback(frame);
+
+			FrameRef frameRef = av_frame_clone(frame);
+			check_av_pointer(frameRef);
+			if (!decodedFrames.Push(move(frameRef)))
+				break;
+			++pipelineStats->decodedFrameCount;
+			++pipelineStats->decodedQueueDepth;
+		}
+		decodedFrames.Close();
+	}
+	catch (...)
+	{
+		abortPipeline();
+		throw;
+	}
+
+	filterThread.join();
+	for (auto& encodeThread : encodeThreads)
+		encodeThread.join();
+
+	if (filterException)
+		rethrow_exception(filterException);
+	if (encodeException)
+		rethrow_exception(encodeException);
+}
+
+void FFmpegController::ConcatenateOutputVideos(const vector<string>& segmentFilenamesUtf8, const char* filenameUtf8,
+	const char* encoderTitleUtf8, bool dumpFormat)
+{
+	int ret;
+
+	AutoReleasePtr<AVFormatContext, avformat_free_context> concatFormatContext;
+	check_av_result(avformat_alloc_output_context2(&concatFormatContext, nullptr, nullptr, filenameUtf8));
+	concatFormatContext->avoid_negative_ts = AVFMT_AVOID_NEG_TS_MAKE_NON_NEGATIVE;
+	check_av_result(av_dict_set(&concatFormatContext->metadata, "encoder-app", encoderTitleUtf8, 0));
+
+	AVStream* concatVideoStream{};
+	AutoReleasePtr<AVPacket, av_packet_free> packet = av_packet_alloc();
+	check_av_pointer(packet);
+
+	// every segment continues where the previous one's last frame ended
+	int64_t segmentStartPts = 0;
+	int64_t lastDts = AV_NOPTS_VALUE;
+	for (auto& segmentFilenameUtf8 : segmentFilenamesUtf8)
+	{
+		AutoReleasePtr<AVFormatContext, avformat_close_input> segmentFormatContext;
+		check_av_result(avformat_open_input(&segmentFormatContext, segmentFilenameUtf8.c_str(), nullptr, nullptr));
+		check_av_result(avformat_find_stream_info(&*segmentFormatContext, nullptr));
+		auto segmentVideoStream = segmentFormatContext->streams[0];
+
+		if (!concatVideoStream)
+		{
+			// the first segment provides the stream parameters for the whole output
+			check_av_pointer(concatVideoStream = avformat_new_stream(&*concatFormatContext, nullptr));
+			check_av_result(avcodec_parameters_copy(concatVideoStream->codecpar, segmentVideoStream->codecpar));
+			concatVideoStream->codecpar->codec_tag = GetRemuxCodecTag(*concatFormatContext, *concatVideoStream->codecpar);
+			concatVideoStream->time_base = segmentVideoStream->time_base;
+
+			if (dumpFormat)
+				av_dump_format(&*concatFormatContext, 0, filenameUtf8, 1);
+
+			if (!(concatFormatContext->oformat->flags & AVFMT_NOFILE))
+				check_av_result(avio_open(&concatFormatContext->pb, filenameUtf8, AVIO_FLAG_WRITE));
+			check_av_result(avformat_write_header(&*concatFormatContext, nullptr));
+		}
+		else if (segmentVideoStream->codecpar->extradata_size != concatVideoStream->codecpar->extradata_size
+			|| memcmp(segmentVideoStream->codecpar->extradata, concatVideoStream->codecpar->extradata, segmentVideoStream->codecpar->extradata_size))
+		{
+			av_log(nullptr, AV_LOG_WARNING, "Segment %s has different codec extradata than the first segment.\n", segmentFilenameUtf8.c_str());
+		}
+
+		auto segmentFirstPts = segmentVideoStream->start_time == AV_NOPTS_VALUE ? 0
+			: av_rescale_q(segmentVideoStream->start_time, segmentVideoStream->time_base, concatVideoStream->time_base);
+		int64_t segmentOffset = AV_NOPTS_VALUE;
+
+		auto segmentEndPts = segmentStartPts;
+		while ((ret = av_read_frame(&*segmentFormatContext, &*packet)) >= 0)
+		{
+			av_packet_rescale_ts(&*packet, segmentVideoStream->time_base, concatVideoStream->time_base);
+
+			if (segmentOffset == AV_NOPTS_VALUE)
+			{
+				// segments don't all share a reorder delay (copied source GOPs vs. our own encodes),
+				// so push the segment back when its first dts would land before the previous one's last
+				segmentOffset = segmentStartPts - segmentFirstPts;
+				if (lastDts != AV_NOPTS_VALUE && packet->dts != AV_NOPTS_VALUE && packet->dts + segmentOffset <= lastDts)
+					segmentOffset = lastDts + 1 - packet->dts;
+			}
+
+			if (packet->pts != AV_NOPTS_VALUE)
+			{
+				packet->pts += segmentOffset;
+				segmentEndPts = max(segmentEndPts, packet->pts + packet->duration);
+			}
+			if (packet->dts != AV_NOPTS_VALUE)
+			{
+				packet->dts += segmentOffset;
+				lastDts = packet->dts;
+			}
+			packet->stream_index = concatVideoStream->index;
+			packet->pos = -1;
+
+			check_av_result(av_interleaved_write_frame(&*concatFormatContext, &*packet));
+		}
+		if (ret != AVERROR_EOF)
+			check_av_result(ret);
+
+		segmentStartPts = segmentEndPts;
+	}
+
+	if (concatVideoStream)
+	{
+		check_av_result(av_write_trailer(&*concatFormatContext));
+		if (!(concatFormatContext->oformat->flags & AVFMT_NOFILE))
+			check_av_result(avio_closep(&concatFormatContext->pb));
+	}
+}
+
+pair<int, int> FFmpegController::GetPreviewSize(AVFrame* frame, int maxWidth, int maxHeight) const
+{
+	auto width = frame->width;
+	auto height = frame->height;
+
+	if (maxWidth > 0 && maxHeight > 0)
+	{
+		auto aspectRatio = (double)width / height;
+		if (aspectRatio >= 1 && width > maxWidth)
+		{
+			width = maxWidth;
+			height = maxWidth / aspectRatio;
+		}
+		else if (aspectRatio < 1 && height > maxHeight)
+		{
+			height = maxHeight;
+			width = maxHeight * aspectRatio;
+		}
+	}
+
+	return { width, height };
+}
+
+void FFmpegController::ConvertFrameToBgra(AVFrame* frame, uint8_t* dst, int dstStride, int dstWidth, int dstHeight)
+{
+	int ret;
+
+	uint8_t* dstData[4] = { dst };
+	int dstLinesize[4] = { dstStride };
+
+	// common decoder output formats have their own kernels, swscale handles the rest
+	if (previewConverter.Convert(frame, dst, dstStride, dstWidth, dstHeight))
+		return;
+
+	auto swsContext = previewScalerCache.Get({ frame->width, frame->height, (AVPixelFormat)frame->format,
+		dstWidth, dstHeight, AV_PIX_FMT_BGRA, SWS_FAST_BILINEAR });
+
+	check_av_result(sws_scale(swsContext, frame->data, frame->linesize, 0, frame->height, dstData, dstLinesize));
+}
+
+MediaTime FFmpegController::GetFramePosition(AVFrame* frame) const
+{
+	return MediaTimeFromSeconds(frame->best_effort_timestamp * av_q2d(inputVideoStream->time_base));
+}
+
+MediaTime FFmpegController::GetFrameDuration(AVFrame* frame) const
+{
+	return MediaTimeFromSeconds(frame->duration * av_q2d(inputVideoStream->time_base));
+}
+
+int64_t FFmpegController::GetPtsFromPosition(MediaTime position) const
+{
+	return llround(MediaTimeToSeconds(position) / av_q2d(inputVideoStream->time_base));
+}
+
+bool FFmpegController::Seek(MediaTime position, const function<void(AVFrame*)>& decodedFrameCallback)
+{
+	int ret;
+
+	// convert the timespan to pts
+	auto dPts = (MediaTimeToSeconds(position) - 1.0 / frameRate)
+		* inputVideoStream->time_base.den / inputVideoStream->time_base.num;
+	auto pts = llround(dPts);
+
+	ret = INT_MIN;
+	auto seekPts = pts;
+	int retries = 10;
+
+	AutoReleasePtr<AVPacket, av_packet_free> packet = av_packet_alloc();
+	check_av_pointer(packet);
+	AutoReleasePtr<AVFrame, av_frame_free> frame = av_frame_alloc();
+
+	// with an index we know which keyframe to land on, no guessing needed
+	if (auto keyframe = FindSeekKeyframe(pts))
+	{
+		avcodec_flush_buffers(&*inputCodecContext);
+		ret = av_seek_frame(&*inputFormatContext, inputVideoStream->index, keyframe->dts, AVSEEK_FLAG_BACKWARD);
+		avcodec_flush_buffers(&*inputCodecContext);
+
+		if (ret >= 0)
+			av_log(nullptr, AV_LOG_DEBUG, "Seeking to keyframe at dts %lld, %lld frames to decode.\n", keyframe->dts,
+				llround((pts - GetKeyframePresentationTimestamp(*keyframe)) * av_q2d(inputVideoStream->time_base) * frameRate) + 1);
+	}
+
+	// otherwise guess, stepping back until the container accepts the seek
+	for (; retries > 0 && ret < 0; --retries)
+	{
+		//if (ret > INT_MIN)
+		//	avio_seek(&*inputFormatContext->pb, 0, SEEK_SET);
+		avcodec_flush_buffers(&*inputCodecContext);
+		//ret = avformat_seek_file(&*inputFormatContext, -1, INT64_MIN, seekPts, INT64_MAX, 0);
+		ret = av_seek_frame(&*inputFormatContext, inputVideoStream->index, seekPts, AVSEEK_FLAG_BACKWARD);
+		avcodec_flush_buffers(&*inputCodecContext);
+
+		// set up a potential retry at an earlier point
+		seekPts -= 2 * inputVideoStream->time_base.den / inputVideoStream->time_base.num;
+	}
+
+	if (retries == 0)
+		return false;
+
+	if (position.count() == 0)
+		return true;
+
+	// fast forward until the expected timestamp
+	flushing = false;
+	while (true)
+	{
+		ret = av_read_frame(&*inputFormatContext, &*packet);
+		if (ret == AVERROR_EOF)
+			flushing = true;
+		else
+			check_av_result(ret);
+
+		if (flushing || packet->stream_index == inputVideoStream->index)
+		{
+			check_av_result(avcodec_send_packet(&*inputCodecContext, flushing ? nullptr : &*packet));
+			while (true)
+			{
+				ret = avcodec_receive_frame(&*inputCodecContext, &*frame);
+				if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+					break;
+				check_av_result(ret);
+
+				// let the caller keep the frames we had to decode to get here
+				if (decodedFrameCallback)
+					decodedFrameCallback(&*frame);
+
+				if (frame->best_effort_timestamp >= pts)
+				{
+					// found the frame, stop here
+					inputFrameNumber = llround(1 + frame->best_effort_timestamp
+						* frameRate * inputVideoStream->time_base.num / inputVideoStream->time_base.den);
+					validTrimmingRangeEntryIndex = 0;
+					return true;
+				}
+			}
+
+			// if we get here in flushing mode, we've failed to find the frame
+			if (flushing)
+				return false;
+		}
+		av_packet_unref(&*packet);
+	}
+
+	// we couldn't find the frame
+	return false;
+}
+
+bool FFmpegController::DecodeKeyframe(MediaTime position, const function<void(AVFrame*)>& frameCallback)
+{
+	int ret;
+	auto pts = GetPtsFromPosition(position);
+
+	AutoReleasePtr<AVPacket, av_packet_free> packet = av_packet_alloc();
+	check_av_pointer(packet);
+	AutoReleasePtr<AVFrame, av_frame_free> frame = av_frame_alloc();
+
+	// land on the keyframe at or before the position, the index knows exactly where it is
+	auto keyframe = FindSeekKeyframe(pts);
+	avcodec_flush_buffers(&*inputCodecContext);
+	check_av_result(av_seek_frame(&*inputFormatContext, inputVideoStream->index, keyframe ? keyframe->dts : pts, AVSEEK_FLAG_BACKWARD));
+
+	// decode only the first keyframe packet, then drain the decoder for its frame
+	while (true)
+	{
+		ret = av_read_frame(&*inputFormatContext, &*packet);
+		if (ret == AVERROR_EOF)
+			return false;
+		check_av_result(ret);
+
+		if (packet->stream_index != inputVideoStream->index || !(packet->flags & AV_PKT_FLAG_KEY))
+		{
+			av_packet_unref(&*packet);
+			continue;
+		}
+
+		check_av_result(avcodec_send_packet(&*inputCodecContext, &*packet));
+		av_packet_unref(&*packet);
+		check_av_result(avcodec_send_packet(&*inputCodecContext, nullptr));
+		break;
+	}
+
+	bool found = false;
+	while (true)
+	{
+		ret = avcodec_receive_frame(&*inputCodecContext, &*frame);
+		if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+			break;
+		check_av_result(ret);
+
+		if (!found)
+		{
+			frameCallback(&*frame);
+			found = true;
+		}
+		av_frame_unref(&*frame);
+	}
+
+	// leave the decoder ready for the next seek after draining it
+	avcodec_flush_buffers(&*inputCodecContext);
+	return found;
+}
+
+int64_t FFmpegController::GetInputFrameNumber(MediaTime position) const
+{
+	return GetFrameNumberFromPts(GetPtsFromPosition(position));
+}
+
+int64_t FFmpegController::GetFrameNumberFromPts(int64_t pts) const
+{
+	if (framePresentationTimestamps.empty())
+		return llround(pts * av_q2d(inputVideoStream->time_base) * frameRate);
+
+	// last frame presented by pts, with half a frame of slack for rounded positions
+	auto halfFrame = llround(0.5 / frameRate / av_q2d(inputVideoStream->time_base));
+	auto it = upper_bound(framePresentationTimestamps.begin(), framePresentationTimestamps.end(), pts + halfFrame);
+	return max<int64_t>(0, it - framePresentationTimestamps.begin() - 1);
+}
+
+int64_t FFmpegController::GetPtsFromFrameNumber(int64_t frameNumber) const
+{
+	if (frameNumber >= 0 && frameNumber < ssize(framePresentationTimestamps))
+		return framePresentationTimestamps[frameNumber];
+	return GetPtsFromPosition(GetDurationFromFrameNumber(frameNumber));
+}
+
+bool FFmpegController::SeekToFrame(int64_t frameNumber, const function<void(AVFrame*)>& decodedFrameCallback)
+{
+	if (framePresentationTimestamps.empty() || frameNumber < 0 || frameNumber >= ssize(framePresentationTimestamps))
+		return Seek(GetDurationFromFrameNumber(frameNumber), decodedFrameCallback);
+
+	// no indexed keyframe at or before the frame (an index without one near the start), the approximate seek still gets there
+	auto targetPts = framePresentationTimestamps[frameNumber];
+	auto keyframe = FindSeekKeyframe(targetPts);
+	if (!keyframe)
+		return Seek(GetDurationFromFrameNumber(frameNumber), decodedFrameCallback);
+
+	int ret;
+
+	AutoReleasePtr<AVPacket, av_packet_free> packet = av_packet_alloc();
+	check_av_pointer(packet);
+	AutoReleasePtr<AVFrame, av_frame_free> frame = av_frame_alloc();
+
+	avcodec_flush_buffers(&*inputCodecContext);
+	check_av_result(av_seek_frame(&*inputFormatContext, inputVideoStream->index, keyframe->dts, AVSEEK_FLAG_BACKWARD));
+
+	flushing = false;
+	validTrimmingRangeEntryIndex = 0;
+	inputFrameNumber = frameNumber;
+
+	// like Seek, the frame enumerator decodes the requested frame next, so when it's
+	// the keyframe we're done, otherwise stop right after the frame before it
+	if (frameNumber == 0 || GetKeyframePresentationTimestamp(*keyframe) >= targetPts)
+		return true;
+
+	auto previousPts = framePresentationTimestamps[frameNumber - 1];
+	av_log(nullptr, AV_LOG_DEBUG, "Seeking to frame %lld from keyframe at dts %lld.\n", frameNumber, keyframe->dts);
+
+	while (true)
+	{
+		ret = av_read_frame(&*inputFormatContext, &*packet);
+		if (ret == AVERROR_EOF)
+			flushing = true;
+		else
+			check_av_result(ret);
+
+		if (!flushing && packet->stream_index != inputVideoStream->index)
+		{
+			av_packet_unref(&*packet);
+			continue;
+		}
+
+		check_av_result(avcodec_send_packet(&*inputCodecContext, flushing ? nullptr : &*packet));
+		av_packet_unref(&*packet);
+
+		while (true)
+		{
+			ret = avcodec_receive_frame(&*inputCodecContext, &*frame);
+			if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+				break;
+			check_av_result(ret);
+
+			if (decodedFrameCallback)
+				decodedFrameCallback(&*frame);
+
+			if (frame->best_effort_timestamp >= previousPts)
+				return true;
+		}
+
+		// flushed everything without reaching the frame
+		if (flushing)
+			return false;
+	}
+}
+
+void FFmpegController::CloseOutputs()
+{
+	int ret;
+
+	// only once, even if one of them fails: the destructor tries again otherwise
+	if (outputsClosed)
+		return;
+	outputsClosed = true;
+
+	// write trailer and close the writer for open output videos, then report the first failure
+	int firstError = 0;
+	for (auto& outputVideo : outputVideos)
+		if (outputVideo->formatContext)
+		{
+			if ((ret = av_write_trailer(&*outputVideo->formatContext)) < 0 && !firstError)
+				firstError = ret;
+			if ((ret = avio_closep(&outputVideo->formatContext->pb)) < 0 && !firstError)
+				firstError = ret;
+		}
+
+	// the DASH muxer writes the final manifest, it opens and closes its files itself
+	if (ladderFormatContext && !outputVideos.empty())
+		if ((ret = av_write_trailer(&*ladderFormatContext)) < 0 && !firstError)
+			firstError = ret;
+
+	if (firstError)
+		throw_av_error(firstError);
+}
+
+FFmpegController::~FFmpegController()
+{
+	av_log(nullptr, AV_LOG_VERBOSE, "Scaler cache: preview %llu hits / %llu misses, crop %llu hits / %llu misses.\n",
+		previewScalerCache.GetHitCount(), previewScalerCache.GetMissCount(),
+		cropScalerCache.GetHitCount(), cropScalerCache.GetMissCount());
+
+	// outputs left open by a failed or abandoned export still get a playable file if the muxer can manage it, but
+	// destruction can't throw, so failures are only logged
+	try
+	{
+		CloseOutputs();
+	}
+	catch (const exception& e)
+	{
+		av_log(nullptr, AV_LOG_ERROR, "Closing the output videos failed: %s\n", e.what());
+	}
+}
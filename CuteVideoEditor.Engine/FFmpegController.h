@@ -0,0 +1,285 @@
+#pragma once
+
+#include "ScalerCache.h"
+#include "PacketIndexFile.h"
+#include "PreviewConverter.h"
+
+enum FFmpegControllerThreadedType
+{
+	FrameThreads, SlideThreads, SingleThread
+};
+
+// same values as the WinRT OutputType, OutputPresetType and RateControlMode, which cast straight to these
+enum class FFmpegControllerOutputType
+{
+	Mp4, Vp8, Vp9, Av1, Mp4Hevc
+};
+
+enum class FFmpegControllerPresetType
+{
+	UltraFast, SuperFast, VeryFast, Faster, Fast, Medium, Slow, Slower, VerySlow, Placebo, Draft
+};
+
+enum class FFmpegControllerRateControlMode
+{
+	Crf, Vbv, TwoPass
+};
+
+struct FFmpegControllerCropRectangle
+{
+	int centerX, centerY, width, height;
+};
+
+// crop keyframe, the crop is interpolated between consecutive entries
+struct FFmpegControllerCropFrame
+{
+	int64_t frameNumber;
+	FFmpegControllerCropRectangle cropRectangle;
+};
+
+// the frames between this marker and the next are dropped when trimAfter is set
+struct FFmpegControllerTrimmingMarker
+{
+	int64_t frameNumber;
+	bool trimAfter;
+};
+
+// an independently encodable piece of the output, in input time with its first output frame number;
+// stream copied segments are whole source GOPs that go to the output without being decoded
+struct FFmpegControllerExportSegment
+{
+	MediaTime start, end;
+	int64_t outputFrameOffset;
+	int64_t frameCount;
+	bool streamCopy{};
+};
+
+// running totals the pipeline stages bump as they go, read from any thread for progress reports; several
+// controllers (segments, two pass) can share one, so queue depths are tracked as increments as well
+struct FFmpegControllerPipelineStats
+{
+	std::atomic<int64_t> decodedFrameCount, filteredFrameCount, encodedFrameCount, bytesWritten;
+	std::atomic<int64_t> decodedQueueDepth, filteredQueueDepth;
+};
+
+// where the encoder has to place keyframes: scene cuts and trimming range starts, in output frame numbers,
+// with the GOP length to use between them
+struct FFmpegControllerKeyframePlan
+{
+	std::vector<int64_t> keyframeNumbers;
+	int gopSize{};
+};
+
+// one step of an adaptive bitrate ladder, capped at maxBitrateKbps when that's set
+struct FFmpegControllerRendition
+{
+	uint32_t width, height;
+	uint32_t crf;
+	uint32_t maxBitrateKbps{};
+};
+
+// one encoder and muxer, with its own size, codec and frame rate; the crop in front of it is shared
+struct FFmpegControllerOutputVideo
+{
+	// null for ladder renditions, which are streams of the ladder's muxer
+	AutoReleasePtr<AVFormatContext, avformat_free_context> formatContext;
+	AutoReleasePtr<AVCodecContext, avcodec_free_context> codecContext;
+	AVStream* videoStream{};
+	AutoReleasePtr<AVPacket, av_packet_unref> packet = av_packet_alloc();
+	AutoReleasePtr<AVFrame, av_frame_free> filteredFrame = av_frame_alloc();
+	int64_t encodedFrameNumber{};
+	std::chrono::steady_clock::time_point encodeStartTime;
+};
+
+class FFmpegController
+{
+	// lets the engine tests set up an input's timing and packet index without a media file
+	friend struct FFmpegControllerTestAccess;
+
+	// input data
+	AutoReleasePtr<AVFormatContext, avformat_close_input> inputFormatContext;
+	AVStream* inputVideoStream{};
+	AutoReleasePtr<AVCodecContext, avcodec_free_context> inputCodecContext;
+	MediaTime mediaDuration{};
+	double frameRate{};
+	std::vector<std::pair<MediaTime, MediaTime>> validTrimmingRanges;
+	std::vector<FFmpegControllerCropFrame> cropFrames;
+	FFmpegControllerThreadedType inputThreadType;
+	int decoderThreadCount{};
+
+	// packets sorted by dts, either from the container's own index, a packet-only scan or a sidecar index file;
+	// the spans point into the owned vectors or straight into the memory mapped sidecar
+	std::vector<PacketIndexEntry> ownedPacketIndex;
+	std::vector<uint64_t> ownedKeyframePacketIndices;
+	std::span<const PacketIndexEntry> packetIndex;
+	std::span<const uint64_t> keyframePacketIndices;
+	PacketIndexFile packetIndexFile;
+
+	// presentation timestamp of every frame in display order, the frame number is the position in the vector;
+	// empty when the index doesn't know packet pts (container indices), seeking then falls back to time arithmetic
+	std::vector<int64_t> framePresentationTimestamps;
+
+	int64_t inputFrameNumber{};
+	bool flushing{};
+	int validTrimmingRangeEntryIndex{};
+	int cropFrameEntryIndex{};
+
+	AutoReleasePtr<AVPacket, av_packet_free> inputPacket = av_packet_alloc();
+
+	// output data, every OpenOutputVideo call adds an output fed from the same decode and crop
+	std::vector<std::unique_ptr<FFmpegControllerOutputVideo>> outputVideos;
+	static constexpr int outputGopSize = 600;
+	double frameRateMultiplier = 1;
+	int encoderThreadCount{};
+	bool matchSourceEncoding{};
+	int64_t filteredFrameNumber{};
+	bool outputsClosed{};
+
+	// the ladder's DASH muxer, written to by every rendition's encode thread
+	AutoReleasePtr<AVFormatContext, avformat_free_context> ladderFormatContext;
+	std::mutex ladderMutex;
+	bool onlyPlannedKeyframes{};
+
+	// bitrate targets on top of the CRF; two pass encodes run the analysis pass (1) on their own controller and
+	// hand its statistics to the final pass (2): libvpx and libaom keep them in memory, x264 and x265 in a file
+	FFmpegControllerRateControlMode rateControlMode = FFmpegControllerRateControlMode::Crf;
+	uint32_t bitrateKbps{};
+	int encodingPass{};
+	std::string twoPassStats;
+	std::string twoPassStatsFilenameUtf8;
+
+	// empty unless the scenes were analyzed first
+	FFmpegControllerKeyframePlan keyframePlan;
+
+	FFmpegControllerPipelineStats ownPipelineStats;
+	FFmpegControllerPipelineStats* pipelineStats = &ownPipelineStats;
+
+	// frames buffered between each pair of pipeline stages
+	static constexpr size_t pipelineQueueCapacity = 8;
+
+	// export segments never span more than this many output GOPs
+	static constexpr int64_t exportSegmentGopCount = 4;
+
+	// input -> output crop + scale, with one scaler per distinct crop size and output
+	ScalerCache cropScalerCache{ 64 };
+
+	// helpers
+	void throw_av_error(int ret);
+	void BuildPacketIndex(bool scanPackets);
+	void BuildFrameTimestampMap();
+	int64_t GetKeyframePresentationTimestamp(const PacketIndexEntry& entry) const;
+	const PacketIndexEntry* FindSeekKeyframe(int64_t pts) const;
+	MediaTime GetDurationFromFrameNumber(int64_t frameNumber) const;
+	int64_t GetFrameNumberFromPts(int64_t pts) const;
+	int64_t GetPtsFromFrameNumber(int64_t frameNumber) const;
+	int64_t GetFrameNumberFromDuration(MediaTime duration) const;
+	FFmpegControllerCropRectangle GetCurrentCropRectangle();
+	void SetupEncodingParameters(AVCodecContext& ctx, FFmpegControllerOutputType outputType, uint32_t crf,
+		FFmpegControllerPresetType preset);
+	void SetupRateControl(AVCodecContext& ctx, FFmpegControllerOutputType outputType);
+	void OpenEncoder(FFmpegControllerOutputVideo& outputVideo, AVFormatContext& formatContext, FFmpegControllerOutputType outputType,
+		uint32_t crf, FFmpegControllerPresetType preset, uint32_t width, uint32_t height);
+	void FilterFrame(AVFrame* frame, const std::function<void(size_t outputIndex, AVFrame*)>& filteredFrameCallback);
+	void EncodeFilteredFrame(size_t outputIndex, AVFrame* frame);
+
+	ScalerCache previewScalerCache{ 8 };
+	PreviewConverter previewConverter;
+
+public:
+	void OpenInputVideo(const char* filenameUtf8, bool dumpFormat, bool scanPacketIndex = false, const char* packetIndexFilenameUtf8 = nullptr);
+
+	// after OpenInputVideo, seeks with another controller's index of the same file; that controller has to outlive this one
+	void SharePacketIndex(const FFmpegController& other);
+	FFmpegControllerThreadedType GetInputThreadType() const { return inputThreadType; }
+
+	// before OpenInputVideo, 0 lets FFmpeg pick from the core count
+	void SetDecoderThreadCount(int count) { decoderThreadCount = count; }
+	MediaTime GetMediaDuration() const { return mediaDuration; }
+	void SetValidTrimmingRanges(const std::vector<FFmpegControllerTrimmingMarker>& trimmingMarkers);
+	void SetValidTrimmingRange(MediaTime start, MediaTime end);
+	std::vector<FFmpegControllerExportSegment> GetExportSegments() const;
+	std::vector<FFmpegControllerExportSegment> GetSmartRenderSegments() const;
+	bool CanStreamCopy(FFmpegControllerOutputType outputType, uint32_t width, uint32_t height,
+		const std::vector<FFmpegControllerCropFrame>& cropFrames) const;
+	asyncpp::generator<AVFrame*> EnumerateInputFrames();
+	bool Seek(MediaTime position, const std::function<void(AVFrame*)>& decodedFrameCallback = {});
+	bool SeekToFrame(int64_t frameNumber, const std::function<void(AVFrame*)>& decodedFrameCallback = {});
+	int64_t GetInputFrameNumber(MediaTime position) const;
+
+	// keyframe-only decoding, for thumbnails where the nearest keyframe is close enough
+	void SetSkipNonKeyframes(bool skip) { inputCodecContext->skip_frame = skip ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT; }
+
+	// trades deblocking accuracy for decoding speed, for previews that are only on screen for a moment
+	void SetSkipLoopFilter(bool skip) { inputCodecContext->skip_loop_filter = skip ? AVDISCARD_ALL : AVDISCARD_DEFAULT; }
+	bool DecodeKeyframe(MediaTime position, const std::function<void(AVFrame*)>& frameCallback);
+
+	// every call adds an output encoding the same cropped frames, with the encoder thread count, frame rate multiplier
+	// and rate control set before it; two pass encodes only take a single output
+	void OpenOutputVideo(const char* filenameUtf8, FFmpegControllerOutputType outputType, uint32_t crf,
+		FFmpegControllerPresetType preset,
+		uint32_t width, uint32_t height, const char* encoderTitleUtf8,
+		const std::vector<FFmpegControllerCropFrame>& cropFrames, bool dumpFormat);
+
+	// every rendition encodes the same crop at its own size, with keyframes only on the segment boundaries (and the
+	// planned scene cuts) so they line up across renditions; fragmented MP4 (H.264, HEVC) or WebM (VP8, VP9, AV1)
+	// segments behind a DASH manifest, plus an HLS playlist for MP4
+	void OpenOutputLadder(const char* manifestFilenameUtf8, FFmpegControllerOutputType outputType, FFmpegControllerPresetType preset,
+		const std::vector<FFmpegControllerRendition>& renditions, MediaTime segmentDuration, const char* encoderTitleUtf8,
+		const std::vector<FFmpegControllerCropFrame>& cropFrames, bool dumpFormat);
+
+	void SetEncoderThreadCount(int count) { encoderThreadCount = count; }
+	void SetFrameRateMultiplier(double multiplier) { frameRateMultiplier = multiplier; }
+	void SetRateControl(FFmpegControllerRateControlMode mode, uint32_t bitrateKbps) { rateControlMode = mode; this->bitrateKbps = bitrateKbps; }
+	void SetEncodingPass(int pass, std::string statsFilenameUtf8, std::string stats = {})
+	{
+		encodingPass = pass;
+		twoPassStatsFilenameUtf8 = std::move(statsFilenameUtf8);
+		twoPassStats = std::move(stats);
+	}
+
+	// the first pass statistics, only complete once the encoder was flushed
+	std::string GetTwoPassStats() const
+	{
+		return !outputVideos.empty() && outputVideos.front()->codecContext->stats_out ? outputVideos.front()->codecContext->stats_out : "";
+	}
+	size_t GetOutputVideoCount() const { return outputVideos.size(); }
+	void SetOutputFrameOffset(int64_t offset) { filteredFrameNumber = offset; }
+
+	// decodes everything in the trimming ranges to find scene cuts, on a controller of its own
+	FFmpegControllerKeyframePlan AnalyzeScenes();
+	const FFmpegControllerKeyframePlan& GetKeyframePlan() const { return keyframePlan; }
+	void SetKeyframePlan(FFmpegControllerKeyframePlan plan) { keyframePlan = std::move(plan); }
+
+	// encode with the source's profile and in-band parameter sets, so the output can sit between copied source GOPs
+	void SetMatchSourceEncoding(bool value) { matchSourceEncoding = value; }
+	void StreamCopySegment(MediaTime start, MediaTime end,
+		const char* filenameUtf8, const char* encoderTitleUtf8);
+
+	void SetPipelineStats(FFmpegControllerPipelineStats& stats) { pipelineStats = &stats; }
+	const FFmpegControllerPipelineStats& GetPipelineStats() const { return *pipelineStats; }
+	int64_t GetOutputFrameCount() const;
+
+	void EncodeFrame(AVFrame* frame);
+	void RunEncodingPipeline(const std::function<void(AVFrame*)>& inputFrameCallback);
+
+	// writes the trailers and closes the files once the encode is done; the destructor does it for outputs left
+	// open, but can only log a failure there
+	void CloseOutputs();
+
+	void ConcatenateOutputVideos(const std::vector<std::string>& segmentFilenamesUtf8, const char* filenameUtf8,
+		const char* encoderTitleUtf8, bool dumpFormat);
+
+	std::pair<int, int> GetPreviewSize(AVFrame* frame, int maxWidth = 0, int maxHeight = 0) const;
+
+	// BGRA into caller owned memory, e.g. a locked bitmap buffer
+	void ConvertFrameToBgra(AVFrame* frame, uint8_t* dst, int dstStride, int dstWidth, int dstHeight);
+	const ScalerCache& GetPreviewScalerCache() const { return previewScalerCache; }
+	const ScalerCache& GetCropScalerCache() const { return cropScalerCache; }
+
+	double GetFrameRate() const { return frameRate; }
+	MediaTime GetFramePosition(AVFrame* frame) const;
+	MediaTime GetFrameDuration(AVFrame* frame) const;
+	int64_t GetPtsFromPosition(MediaTime position) const;
+
+	~FFmpegController();
+};
@@ -0,0 +1,164 @@
+#include "EngineCommon.h"
+#include "PacketIndexFile.h"
+
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+bool PacketIndexFile::GetMediaStamp(const filesystem::path& mediaFileName, int64_t& size, int64_t& writeTime)
+{
+	error_code ec;
+	size = static_cast<int64_t>(filesystem::file_size(mediaFileName, ec));
+	if (ec)
+		return false;
+
+	writeTime = filesystem::last_write_time(mediaFileName, ec).time_since_epoch().count();
+	return !ec;
+}
+
+bool PacketIndexFile::Open(const filesystem::path& fileName, const filesystem::path& mediaFileName)
+{
+	Close();
+
+	int64_t mediaFileSize, mediaWriteTime;
+	if (!GetMediaStamp(mediaFileName, mediaFileSize, mediaWriteTime))
+		return false;
+
+#ifdef _WIN32
+	if (auto handle = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr); handle != INVALID_HANDLE_VALUE)
+	{
+		file = handle;
+	}
+	LARGE_INTEGER fileSize;
+	if (!file || !GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(Header))
+	{
+		Close();
+		return false;
+	}
+	viewSize = static_cast<size_t>(fileSize.QuadPart);
+
+	mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping || !(view = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0))))
+	{
+		Close();
+		return false;
+	}
+#else
+	file = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+	struct stat fileStat;
+	if (file < 0 || fstat(file, &fileStat) || fileStat.st_size < (off_t)sizeof(Header))
+	{
+		Close();
+		return false;
+	}
+	viewSize = static_cast<size_t>(fileStat.st_size);
+
+	auto mappedView = mmap(nullptr, viewSize, PROT_READ, MAP_SHARED, file, 0);
+	if (mappedView == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+	view = static_cast<const uint8_t*>(mappedView);
+	madvise(mappedView, viewSize, MADV_RANDOM);
+#endif
+
+	// reject anything written by another version, truncated, or for a media file that changed since; the counts
+	// are checked against the file size one at a time so a corrupt count can't overflow the total
+	auto& header = GetHeader();
+	auto dataSize = viewSize - sizeof(Header);
+	if (header.magic != magic || header.version != version
+		|| header.mediaFileSize != mediaFileSize || header.mediaWriteTime != mediaWriteTime
+		|| header.videoStreamIndex < 0
+		|| header.entryCount > dataSize / sizeof(PacketIndexEntry)
+		|| header.keyframeCount > (dataSize - header.entryCount * sizeof(PacketIndexEntry)) / sizeof(uint64_t)
+		|| dataSize != header.entryCount * sizeof(PacketIndexEntry) + header.keyframeCount * sizeof(uint64_t))
+	{
+		av_log(nullptr, AV_LOG_VERBOSE, "Ignoring stale packet index file.\n");
+		Close();
+		return false;
+	}
+
+	// the keyframe list indexes the entries, which are used unchecked from here on
+	for (auto keyframePacketIndex : GetKeyframePacketIndices())
+		if (keyframePacketIndex >= header.entryCount)
+		{
+			av_log(nullptr, AV_LOG_WARNING, "Ignoring corrupt packet index file.\n");
+			Close();
+			return false;
+		}
+
+	return true;
+}
+
+void PacketIndexFile::Close()
+{
+#ifdef _WIN32
+	if (view)
+		UnmapViewOfFile(view);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file)
+		CloseHandle(file);
+	mapping = file = nullptr;
+#else
+	if (view)
+		munmap(const_cast<uint8_t*>(view), viewSize);
+	if (file >= 0)
+		close(file);
+	file = -1;
+#endif
+
+	view = nullptr;
+	viewSize = 0;
+}
+
+bool PacketIndexFile::Write(const filesystem::path& fileName, const filesystem::path& mediaFileName, Header header,
+	span<const PacketIndexEntry> entries, span<const uint64_t> keyframePacketIndices)
+{
+	header.magic = magic;
+	header.version = version;
+	header.reserved = 0;
+	header.entryCount = entries.size();
+	header.keyframeCount = keyframePacketIndices.size();
+	if (!GetMediaStamp(mediaFileName, header.mediaFileSize, header.mediaWriteTime))
+		return false;
+
+	ofstream stream(fileName, ios::binary | ios::trunc);
+	stream.write(reinterpret_cast<const char*>(&header), sizeof header);
+	stream.write(reinterpret_cast<const char*>(entries.data()), entries.size_bytes());
+	stream.write(reinterpret_cast<const char*>(keyframePacketIndices.data()), keyframePacketIndices.size_bytes());
+	stream.close();
+
+	if (!stream)
+	{
+		error_code ec;
+		filesystem::remove(fileName, ec);
+		return false;
+	}
+
+	return true;
+}
+
+span<const PacketIndexEntry> PacketIndexFile::GetEntries() const
+{
+	return { reinterpret_cast<const PacketIndexEntry*>(view + sizeof(Header)), GetHeader().entryCount };
+}
+
+span<const uint64_t> PacketIndexFile::GetKeyframePacketIndices() const
+{
+	return { reinterpret_cast<const uint64_t*>(view + sizeof(Header) + GetHeader().entryCount * sizeof(PacketIndexEntry)),
+		GetHeader().keyframeCount };
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <span>
+
+// one demuxed packet of the input video stream, in stream time base
+struct PacketIndexEntry
+{
+	int64_t pts, dts, pos;
+	int32_t size;
+	bool keyframe;
+
+	// spelled out so entries written to the sidecar have no uninitialized padding
+	uint8_t reserved[3]{};
+};
+static_assert(sizeof(PacketIndexEntry) == 32 && std::is_standard_layout_v<PacketIndexEntry>);
+
+// Sidecar file holding the packet index and stream parameters of a media file, so reopening it needs neither stream
+// probing nor a packet scan. The file is memory mapped and its index used in place, and it is only trusted while
+// the media file keeps the size and modification time it was written for.
+class PacketIndexFile
+{
+public:
+	struct Header
+	{
+		uint32_t magic, version;
+		int64_t mediaFileSize, mediaWriteTime;
+		int32_t videoStreamIndex;
+
+		// what stream probing would have found out about the decoder's reordering delay and output format
+		int32_t hasBFrames;
+		AVRational frameRate, guessedFrameRate;
+		int32_t pixelFormat;
+		int32_t reserved;
+		int64_t duration;
+		uint64_t entryCount, keyframeCount;
+	};
+
+	PacketIndexFile() = default;
+	PacketIndexFile(const PacketIndexFile&) = delete;
+	PacketIndexFile& operator=(const PacketIndexFile&) = delete;
+	~PacketIndexFile() { Close(); }
+
+	bool Open(const std::filesystem::path& fileName, const std::filesystem::path& mediaFileName);
+	void Close();
+	bool IsOpen() const { return view; }
+
+	static bool Write(const std::filesystem::path& fileName, const std::filesystem::path& mediaFileName, Header header,
+		std::span<const PacketIndexEntry> entries, std::span<const uint64_t> keyframePacketIndices);
+
+	const Header& GetHeader() const { return *reinterpret_cast<const Header*>(view); }
+	std::span<const PacketIndexEntry> GetEntries() const;
+	std::span<const uint64_t> GetKeyframePacketIndices() const;
+
+private:
+	// "IEVC" as the first four bytes of the file, the header is written in the (little-endian) machine's byte order
+	static constexpr uint32_t magic = 0x43564549;
+	static constexpr uint32_t version = 2;
+
+	static bool GetMediaStamp(const std::filesystem::path& mediaFileName, int64_t& size, int64_t& writeTime);
+
+	// a file handle and mapping object on Windows, a file descriptor elsewhere
+#ifdef _WIN32
+	void* file{};
+	void* mapping{};
+#else
+	int file = -1;
+#endif
+	const uint8_t* view{};
+	size_t viewSize{};
+};
+static_assert(sizeof(PacketIndexFile::Header) == 80 && std::has_unique_object_representations_v<PacketIndexFile::Header>);
@@ -0,0 +1,539 @@
+#include "EngineCommon.h"
+#include "PreviewConverter.h"
+
+// MSVC compiles intrinsics for any target, GCC and Clang only inside functions built for the instruction set
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PREVIEW_CONVERTER_X86
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define PREVIEW_CONVERTER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PREVIEW_CONVERTER_TARGET(isa)
+#endif
+#endif
+
+using namespace std;
+
+namespace
+{
+	// fixed point YUV -> RGB factors in Q13, the kernels work on samples pre-shifted left by 6
+	// so multiplying and keeping the high 16 bits leaves 3 fractional bits
+	struct Coefficients
+	{
+		int16_t yOffset, yMul, vToR, uToG, vToG, uToB;
+	};
+
+	constexpr int16_t ToQ13(double value) { return static_cast<int16_t>(value * 8192 + 0.5); }
+
+	Coefficients GetCoefficients(const AVFrame* frame)
+	{
+		auto fullRange = frame->color_range == AVCOL_RANGE_JPEG || frame->format == AV_PIX_FMT_YUVJ420P;
+
+		// untagged HD material is almost always BT.709
+		auto bt709 = frame->colorspace == AVCOL_SPC_BT709
+			|| (frame->colorspace == AVCOL_SPC_UNSPECIFIED && frame->height > 576);
+
+		if (fullRange)
+			return bt709
+				? Coefficients{ 0, ToQ13(1), ToQ13(1.5748), ToQ13(0.1873), ToQ13(0.4681), ToQ13(1.8556) }
+				: Coefficients{ 0, ToQ13(1), ToQ13(1.402), ToQ13(0.3441), ToQ13(0.7141), ToQ13(1.772) };
+		return bt709
+			? Coefficients{ 16, ToQ13(1.1644), ToQ13(1.7927), ToQ13(0.2132), ToQ13(0.5329), ToQ13(2.1124) }
+			: Coefficients{ 16, ToQ13(1.1644), ToQ13(1.5960), ToQ13(0.3918), ToQ13(0.8130), ToQ13(2.0172) };
+	}
+
+	// same arithmetic as the vector kernels, so the tails match the rest of the row
+	inline int MulHigh(int value, int16_t coefficient) { return ((value << 6) * coefficient) >> 16; }
+	inline uint8_t ClampToByte(int value) { return static_cast<uint8_t>(value < 0 ? 0 : value > 255 ? 255 : value); }
+
+	void ConvertRowScalar(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const Coefficients& c)
+	{
+		for (int x = 0; x < width; ++x, dst += 4)
+		{
+			auto luma = MulHigh(y[x] - c.yOffset, c.yMul) + 4;
+			auto uu = u[x] - 128, vv = v[x] - 128;
+
+			dst[0] = ClampToByte((luma + MulHigh(uu, c.uToB)) >> 3);
+			dst[1] = ClampToByte((luma - MulHigh(uu, c.uToG) - MulHigh(vv, c.vToG)) >> 3);
+			dst[2] = ClampToByte((luma + MulHigh(vv, c.vToR)) >> 3);
+			dst[3] = 255;
+		}
+	}
+
+	// the vertical pass keeps 7 fractional bits of the 8-bit result, so its output still fits the 16-bit lanes the
+	// horizontal pass multiplies by the Q14 weights (madd); both passes are exact integer sums, so every kernel
+	// writes the same bytes
+	constexpr int filteredFractionBits = 7;
+	constexpr int columnShift = 14 + filteredFractionBits;
+
+	// blends count source rows, starting at plane, into one row of width filtered samples; shift is the bits above 8
+	// per sample
+	template <typename Sample>
+	void FilterRowsScalar(const uint8_t* plane, ptrdiff_t linesize, const uint16_t* weights, int count, int width, int shift, int16_t* dst)
+	{
+		auto rowShift = 14 - filteredFractionBits + shift;
+		for (int x = 0; x < width; ++x)
+		{
+			int32_t sum = 1 << (rowShift - 1);
+			for (int row = 0; row < count; ++row)
+				sum += weights[row] * reinterpret_cast<const Sample*>(plane + row * linesize)[x];
+			dst[x] = static_cast<int16_t>(sum >> rowShift);
+		}
+	}
+
+	// every destination pixel is tapCount filtered samples from first[x] on, weighted by the padded Q14 weights
+	void FilterColumnsScalar(const int16_t* src, const int* first, const int16_t* weights, int tapCount, int width, uint8_t* dst)
+	{
+		for (int x = 0; x < width; ++x, weights += tapCount)
+		{
+			int32_t sum = 1 << (columnShift - 1);
+			for (int tap = 0; tap < tapCount; ++tap)
+				sum += weights[tap] * src[first[x] + tap];
+			dst[x] = ClampToByte(sum >> columnShift);
+		}
+	}
+
+#ifdef PREVIEW_CONVERTER_X86
+	PREVIEW_CONVERTER_TARGET("sse4.1")
+	void ConvertRowSse41(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const Coefficients& c)
+	{
+		auto yOffset = _mm_set1_epi16(c.yOffset), uvOffset = _mm_set1_epi16(128), rounding = _mm_set1_epi16(4);
+		auto yMul = _mm_set1_epi16(c.yMul), vToR = _mm_set1_epi16(c.vToR), uToG = _mm_set1_epi16(c.uToG),
+			vToG = _mm_set1_epi16(c.vToG), uToB = _mm_set1_epi16(c.uToB);
+		auto alpha = _mm_set1_epi8(-1);
+
+		int x = 0;
+		for (; x + 8 <= width; x += 8)
+		{
+			auto yy = _mm_slli_epi16(_mm_sub_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + x))), yOffset), 6);
+			auto uu = _mm_slli_epi16(_mm_sub_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + x))), uvOffset), 6);
+			auto vv = _mm_slli_epi16(_mm_sub_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + x))), uvOffset), 6);
+
+			auto luma = _mm_add_epi16(_mm_mulhi_epi16(yy, yMul), rounding);
+			auto b = _mm_srai_epi16(_mm_add_epi16(luma, _mm_mulhi_epi16(uu, uToB)), 3);
+			auto g = _mm_srai_epi16(_mm_sub_epi16(_mm_sub_epi16(luma, _mm_mulhi_epi16(uu, uToG)), _mm_mulhi_epi16(vv, vToG)), 3);
+			auto r = _mm_srai_epi16(_mm_add_epi16(luma, _mm_mulhi_epi16(vv, vToR)), 3);
+
+			auto bg = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), _mm_packus_epi16(g, g));
+			auto ra = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), alpha);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_unpacklo_epi16(bg, ra));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4 + 16), _mm_unpackhi_epi16(bg, ra));
+		}
+
+		ConvertRowScalar(y + x, u + x, v + x, dst + x * 4, width - x, c);
+	}
+
+	PREVIEW_CONVERTER_TARGET("sse4.1")
+	inline __m128i LoadSamplesSse41(const uint8_t* samples) { return _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(samples))); }
+
+	PREVIEW_CONVERTER_TARGET("sse4.1")
+	inline __m128i LoadSamplesSse41(const uint16_t* samples) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples)); }
+
+	PREVIEW_CONVERTER_TARGET("sse4.1")
+	inline int SumLanesSse41(__m128i value)
+	{
+		value = _mm_add_epi32(value, _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2)));
+		value = _mm_add_epi32(value, _mm_shuffle_epi32(value, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtsi128_si32(value);
+	}
+
+	template <typename Sample>
+	PREVIEW_CONVERTER_TARGET("sse4.1")
+	void FilterRowsSse41(const uint8_t* plane, ptrdiff_t linesize, const uint16_t* weights, int count, int width, int shift, int16_t* dst)
+	{
+		auto rowShift = 14 - filteredFractionBits + shift;
+		auto rounding = _mm_set1_epi32(1 << (rowShift - 1));
+		auto shiftCount = _mm_cvtsi32_si128(rowShift);
+
+		int x = 0;
+		for (; x + 8 <= width; x += 8)
+		{
+			auto low = rounding, high = rounding;
+
+			// two source rows per madd, an odd last one paired with itself at zero weight
+			for (int row = 0; row < count; row += 2)
+			{
+				auto paired = row + 1 < count;
+				auto a = LoadSamplesSse41(reinterpret_cast<const Sample*>(plane + row * linesize) + x);
+				auto b = LoadSamplesSse41(reinterpret_cast<const Sample*>(plane + (paired ? row + 1 : row) * linesize) + x);
+				auto rowWeights = _mm_set1_epi32(weights[row] | (paired ? weights[row + 1] << 16 : 0));
+				low = _mm_add_epi32(low, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), rowWeights));
+				high = _mm_add_epi32(high, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), rowWeights));
+			}
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi32(_mm_sra_epi32(low, shiftCount), _mm_sra_epi32(high, shiftCount)));
+		}
+
+		FilterRowsScalar<Sample>(plane + x * sizeof(Sample), linesize, weights, count, width - x, shift, dst + x);
+	}
+
+	// the taps are padded to a multiple of 8, the source row by as many samples past its end
+	PREVIEW_CONVERTER_TARGET("sse4.1")
+	void FilterColumnsSse41(const int16_t* src, const int* first, const int16_t* weights, int tapCount, int width, uint8_t* dst)
+	{
+		for (int x = 0; x < width; ++x, weights += tapCount)
+		{
+			auto samples = src + first[x];
+			auto sum = _mm_setzero_si128();
+			for (int tap = 0; tap < tapCount; tap += 8)
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + tap)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + tap))));
+			dst[x] = ClampToByte((SumLanesSse41(sum) + (1 << (columnShift - 1))) >> columnShift);
+		}
+	}
+
+	// packus and unpack work within 128-bit lanes, so narrow each half separately
+	PREVIEW_CONVERTER_TARGET("avx2")
+	inline __m128i NarrowAvx2(__m256i value) { return _mm_packus_epi16(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1)); }
+
+	PREVIEW_CONVERTER_TARGET("avx2")
+	void ConvertRowAvx2(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const Coefficients& c)
+	{
+		auto yOffset = _mm256_set1_epi16(c.yOffset), uvOffset = _mm256_set1_epi16(128), rounding = _mm256_set1_epi16(4);
+		auto yMul = _mm256_set1_epi16(c.yMul), vToR = _mm256_set1_epi16(c.vToR), uToG = _mm256_set1_epi16(c.uToG),
+			vToG = _mm256_set1_epi16(c.vToG), uToB = _mm256_set1_epi16(c.uToB);
+		auto alpha = _mm_set1_epi8(-1);
+
+		int x = 0;
+		for (; x + 16 <= width; x += 16)
+		{
+			auto yy = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x))), yOffset), 6);
+			auto uu = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(u + x))), uvOffset), 6);
+			auto vv = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v + x))), uvOffset), 6);
+
+			auto luma = _mm256_add_epi16(_mm256_mulhi_epi16(yy, yMul), rounding);
+			auto b = NarrowAvx2(_mm256_srai_epi16(_mm256_add_epi16(luma, _mm256_mulhi_epi16(uu, uToB)), 3));
+			auto g = NarrowAvx2(_mm256_srai_epi16(_mm256_sub_epi16(_mm256_sub_epi16(luma, _mm256_mulhi_epi16(uu, uToG)), _mm256_mulhi_epi16(vv, vToG)), 3));
+			auto r = NarrowAvx2(_mm256_srai_epi16(_mm256_add_epi16(luma, _mm256_mulhi_epi16(vv, vToR)), 3));
+
+			// pixels 0-7 in the low lanes, 8-15 in the high lanes
+			auto bg = _mm256_set_m128i(_mm_unpackhi_epi8(b, g), _mm_unpacklo_epi8(b, g));
+			auto ra = _mm256_set_m128i(_mm_unpackhi_epi8(r, alpha), _mm_unpacklo_epi8(r, alpha));
+			auto low = _mm256_unpacklo_epi16(bg, ra), high = _mm256_unpackhi_epi16(bg, ra);
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), _mm256_permute2x128_si256(low, high, 0x20));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4 + 32), _mm256_permute2x128_si256(low, high, 0x31));
+		}
+
+		ConvertRowScalar(y + x, u + x, v + x, dst + x * 4, width - x, c);
+	}
+
+	PREVIEW_CONVERTER_TARGET("avx2")
+	inline __m256i LoadSamplesAvx2(const uint8_t* samples) { return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples))); }
+
+	PREVIEW_CONVERTER_TARGET("avx2")
+	inline __m256i LoadSamplesAvx2(const uint16_t* samples) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples)); }
+
+	template <typename Sample>
+	PREVIEW_CONVERTER_TARGET("avx2")
+	void FilterRowsAvx2(const uint8_t* plane, ptrdiff_t linesize, const uint16_t* weights, int count, int width, int shift, int16_t* dst)
+	{
+		auto rowShift = 14 - filteredFractionBits + shift;
+		auto rounding = _mm256_set1_epi32(1 << (rowShift - 1));
+		auto shiftCount = _mm_cvtsi32_si128(rowShift);
+
+		int x = 0;
+		for (; x + 16 <= width; x += 16)
+		{
+			auto low = rounding, high = rounding;
+			for (int row = 0; row < count; row += 2)
+			{
+				auto paired = row + 1 < count;
+				auto a = LoadSamplesAvx2(reinterpret_cast<const Sample*>(plane + row * linesize) + x);
+				auto b = LoadSamplesAvx2(reinterpret_cast<const Sample*>(plane + (paired ? row + 1 : row) * linesize) + x);
+				auto rowWeights = _mm256_set1_epi32(weights[row] | (paired ? weights[row + 1] << 16 : 0));
+				low = _mm256_add_epi32(low, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), rowWeights));
+				high = _mm256_add_epi32(high, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), rowWeights));
+			}
+
+			// unpack and pack both work within 128-bit lanes, so the samples come out in order again
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x),
+				_mm256_packus_epi32(_mm256_sra_epi32(low, shiftCount), _mm256_sra_epi32(high, shiftCount)));
+		}
+
+		FilterRowsScalar<Sample>(plane + x * sizeof(Sample), linesize, weights, count, width - x, shift, dst + x);
+	}
+
+	PREVIEW_CONVERTER_TARGET("avx2")
+	void FilterColumnsAvx2(const int16_t* src, const int* first, const int16_t* weights, int tapCount, int width, uint8_t* dst)
+	{
+		auto rounding = 1 << (columnShift - 1);
+
+		int x = 0;
+		if (tapCount == 8)
+		{
+			// bilinear and shrinking by up to 7:1, two destination pixels per register, one in each lane
+			for (; x + 2 <= width; x += 2, weights += 16)
+			{
+				auto samples = _mm256_set_m128i(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + first[x + 1])),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + first[x])));
+				auto sum = _mm256_madd_epi16(samples, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights)));
+				sum = _mm256_add_epi32(sum, _mm256_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+				sum = _mm256_add_epi32(sum, _mm256_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+				dst[x] = ClampToByte((_mm_cvtsi128_si32(_mm256_castsi256_si128(sum)) + rounding) >> columnShift);
+				dst[x + 1] = ClampToByte((_mm_cvtsi128_si32(_mm256_extracti128_si256(sum, 1)) + rounding) >> columnShift);
+			}
+		}
+		else
+		{
+			for (; x < width; ++x, weights += tapCount)
+			{
+				auto samples = src + first[x];
+				auto sum = _mm256_setzero_si256();
+				int tap = 0;
+				for (; tap + 16 <= tapCount; tap += 16)
+					sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + tap)),
+						_mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + tap))));
+
+				auto laneSum = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+				if (tap < tapCount)
+					laneSum = _mm_add_epi32(laneSum, _mm_madd_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + tap)),
+						_mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + tap))));
+				dst[x] = ClampToByte((SumLanesSse41(laneSum) + rounding) >> columnShift);
+			}
+		}
+
+		FilterColumnsSse41(src, first + x, weights, tapCount, width - x, dst + x);
+	}
+#endif
+
+	template <typename Sample>
+	void FilterRows(PreviewConverter::Kernel kernel, const uint8_t* plane, ptrdiff_t linesize, const uint16_t* weights, int count,
+		int width, int shift, int16_t* dst)
+	{
+#ifdef PREVIEW_CONVERTER_X86
+		if (kernel == PreviewConverter::Kernel::Avx2)
+			return FilterRowsAvx2<Sample>(plane, linesize, weights, count, width, shift, dst);
+		if (kernel == PreviewConverter::Kernel::Sse41)
+			return FilterRowsSse41<Sample>(plane, linesize, weights, count, width, shift, dst);
+#endif
+		FilterRowsScalar<Sample>(plane, linesize, weights, count, width, shift, dst);
+	}
+
+	void FilterColumns(PreviewConverter::Kernel kernel, const int16_t* src, const int* first, const int16_t* weights, int tapCount,
+		int width, uint8_t* dst)
+	{
+#ifdef PREVIEW_CONVERTER_X86
+		if (kernel == PreviewConverter::Kernel::Avx2)
+			return FilterColumnsAvx2(src, first, weights, tapCount, width, dst);
+		if (kernel == PreviewConverter::Kernel::Sse41)
+			return FilterColumnsSse41(src, first, weights, tapCount, width, dst);
+#endif
+		FilterColumnsScalar(src, first, weights, tapCount, width, dst);
+	}
+}
+
+void PreviewConverter::Taps::Build(int newSrcSize, int newDstSize)
+{
+	if (srcSize == newSrcSize && dstSize == newDstSize)
+		return;
+	srcSize = newSrcSize;
+	dstSize = newDstSize;
+
+	first.clear();
+	offset.assign(1, 0);
+	weights.clear();
+
+	auto scale = static_cast<double>(srcSize) / dstSize;
+	for (int d = 0; d < dstSize; ++d)
+	{
+		vector<double> tapWeights;
+		if (scale > 1)
+		{
+			// the share of the destination pixel's footprint each source pixel covers
+			auto left = d * scale, right = (d + 1) * scale;
+			first.push_back(static_cast<int>(left));
+			for (auto s = first.back(); s < srcSize && s < right; ++s)
+				tapWeights.push_back((min<double>(s + 1, right) - max<double>(s, left)) / scale);
+		}
+		else
+		{
+			// between the two source pixels nearest the destination pixel's center, clamped at the edges
+			auto center = clamp((d + 0.5) * scale - 0.5, 0.0, srcSize - 1.0);
+			first.push_back(min(static_cast<int>(center), max(srcSize - 2, 0)));
+			auto fraction = center - first.back();
+			tapWeights.push_back(1 - fraction);
+			if (first.back() + 1 < srcSize)
+				tapWeights.push_back(fraction);
+		}
+
+		// in Q14, with the rounding error on the largest tap so the weights always add up to exactly one
+		int total = 0;
+		auto largest = weights.size();
+		for (auto weight : tapWeights)
+		{
+			auto fixedWeight = static_cast<uint16_t>(lround(weight * 16384));
+			if (weights.size() == largest || fixedWeight > weights[largest])
+				largest = weights.size();
+			weights.push_back(fixedWeight);
+			total += fixedWeight;
+		}
+		weights[largest] = static_cast<uint16_t>(weights[largest] + 16384 - total);
+		offset.push_back(static_cast<int>(weights.size()));
+	}
+
+	// the same weights at a fixed count per destination pixel, a multiple of 8 padded with zeros, for the vector kernels
+	paddedCount = 0;
+	for (int d = 0; d < dstSize; ++d)
+		paddedCount = max(paddedCount, GetCount(d));
+	paddedCount = (paddedCount + 7) / 8 * 8;
+
+	paddedWeights.assign(static_cast<size_t>(dstSize) * paddedCount, 0);
+	for (int d = 0; d < dstSize; ++d)
+		copy(weights.begin() + offset[d], weights.begin() + offset[d + 1], paddedWeights.begin() + static_cast<ptrdiff_t>(d) * paddedCount);
+}
+
+template <typename Sample>
+void PreviewConverter::ResampleRow(const uint8_t* plane, int linesize, int shift, const Taps& rows, const Taps& columns, int dy, uint8_t* dst)
+{
+	// rows first: that pass touches every source sample the destination row covers and runs straight along them, the
+	// column pass then only filters the one blended row
+	filteredRow.resize(static_cast<size_t>(columns.srcSize) + columns.paddedCount);
+	FilterRows<Sample>(kernel, plane + static_cast<ptrdiff_t>(rows.first[dy]) * linesize, linesize, rows.weights.data() + rows.offset[dy],
+		rows.GetCount(dy), columns.srcSize, shift, filteredRow.data());
+	FilterColumns(kernel, filteredRow.data(), columns.first.data(), columns.paddedWeights.data(), columns.paddedCount, columns.dstSize, dst);
+}
+
+void PreviewConverter::ResampleInterleavedRow(const uint8_t* plane, int linesize, const Taps& rows, const Taps& columns, int dy,
+	uint8_t* dstU, uint8_t* dstV)
+{
+	// both planes blended in one go, then split for the column pass
+	interleavedRow.resize(static_cast<size_t>(columns.srcSize) * 2);
+	FilterRows<uint8_t>(kernel, plane + static_cast<ptrdiff_t>(rows.first[dy]) * linesize, linesize, rows.weights.data() + rows.offset[dy],
+		rows.GetCount(dy), columns.srcSize * 2, 0, interleavedRow.data());
+
+	filteredRow.resize(static_cast<size_t>(columns.srcSize) + columns.paddedCount);
+	filteredRowV.resize(filteredRow.size());
+	for (int x = 0; x < columns.srcSize; ++x)
+	{
+		filteredRow[x] = interleavedRow[x * 2];
+		filteredRowV[x] = interleavedRow[x * 2 + 1];
+	}
+
+	FilterColumns(kernel, filteredRow.data(), columns.first.data(), columns.paddedWeights.data(), columns.paddedCount, columns.dstSize, dstU);
+	FilterColumns(kernel, filteredRowV.data(), columns.first.data(), columns.paddedWeights.data(), columns.paddedCount, columns.dstSize, dstV);
+}
+
+PreviewConverter::PreviewConverter()
+{
+#ifdef PREVIEW_CONVERTER_X86
+	auto cpuFlags = av_get_cpu_flags();
+	kernel = cpuFlags & AV_CPU_FLAG_AVX2 ? Kernel::Avx2
+		: cpuFlags & AV_CPU_FLAG_SSE4 ? Kernel::Sse41
+		: Kernel::None;
+#endif
+}
+
+bool PreviewConverter::IsSupportedFormat(AVPixelFormat format)
+{
+	return format == AV_PIX_FMT_YUV420P || format == AV_PIX_FMT_YUVJ420P || format == AV_PIX_FMT_NV12 || format == AV_PIX_FMT_YUV420P10LE;
+}
+
+bool PreviewConverter::Convert(const AVFrame* frame, uint8_t* dst, int dstStride, int dstWidth, int dstHeight)
+{
+	auto format = static_cast<AVPixelFormat>(frame->format);
+	if (kernel == Kernel::None || !IsSupportedFormat(format) || dstWidth <= 0 || dstHeight <= 0)
+		return false;
+
+#ifdef PREVIEW_CONVERTER_X86
+	auto convertRow = kernel == Kernel::Avx2 ? ConvertRowAvx2 : kernel == Kernel::Sse41 ? ConvertRowSse41 : ConvertRowScalar;
+#else
+	auto convertRow = ConvertRowScalar;
+#endif
+	auto coefficients = GetCoefficients(frame);
+
+	// 4:2:0 chroma planes round their size up
+	auto chromaWidth = (frame->width + 1) / 2, chromaHeight = (frame->height + 1) / 2;
+	lumaColumns.Build(frame->width, dstWidth);
+	lumaRows.Build(frame->height, dstHeight);
+	chromaColumns.Build(chromaWidth, dstWidth);
+	chromaRows.Build(chromaHeight, dstHeight);
+
+	rowY.resize(dstWidth);
+	rowU.resize(dstWidth);
+	rowV.resize(dstWidth);
+
+	for (int dy = 0; dy < dstHeight; ++dy)
+	{
+		// filter the row at the destination width, then convert it in one go
+		switch (format)
+		{
+		case AV_PIX_FMT_YUV420P:
+		case AV_PIX_FMT_YUVJ420P:
+			ResampleRow<uint8_t>(frame->data[0], frame->linesize[0], 0, lumaRows, lumaColumns, dy, rowY.data());
+			ResampleRow<uint8_t>(frame->data[1], frame->linesize[1], 0, chromaRows, chromaColumns, dy, rowU.data());
+			ResampleRow<uint8_t>(frame->data[2], frame->linesize[2], 0, chromaRows, chromaColumns, dy, rowV.data());
+			break;
+		case AV_PIX_FMT_NV12:
+			ResampleRow<uint8_t>(frame->data[0], frame->linesize[0], 0, lumaRows, lumaColumns, dy, rowY.data());
+			ResampleInterleavedRow(frame->data[1], frame->linesize[1], chromaRows, chromaColumns, dy, rowU.data(), rowV.data());
+			break;
+		case AV_PIX_FMT_YUV420P10LE:
+			ResampleRow<uint16_t>(frame->data[0], frame->linesize[0], 2, lumaRows, lumaColumns, dy, rowY.data());
+			ResampleRow<uint16_t>(frame->data[1], frame->linesize[1], 2, chromaRows, chromaColumns, dy, rowU.data());
+			ResampleRow<uint16_t>(frame->data[2], frame->linesize[2], 2, chromaRows, chromaColumns, dy, rowV.data());
+			break;
+		}
+
+		convertRow(rowY.data(), rowU.data(), rowV.data(), dst + static_cast<ptrdiff_t>(dy) * dstStride, dstWidth, coefficients);
+	}
+
+	return true;
+}
+
+vector<PreviewConverter::BenchmarkResult> PreviewConverter::Benchmark(const AVFrame* frame, int dstWidth, int dstHeight, int iterations)
+{
+	vector<BenchmarkResult> results;
+
+	auto dstStride = dstWidth * 4;
+	vector<uint8_t> dst(static_cast<size_t>(dstStride) * dstHeight);
+
+	auto time = [&](const char* name, const function<void()>& convert)
+		{
+			convert();
+
+			auto start = chrono::steady_clock::now();
+			for (int i = 0; i < iterations; ++i)
+				convert();
+			auto elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+			results.push_back({ name, elapsed / iterations });
+			av_log(nullptr, AV_LOG_INFO, "Preview conversion %dx%d %s -> %dx%d with %s: %.3f ms/frame.\n", frame->width, frame->height,
+				av_get_pix_fmt_name(static_cast<AVPixelFormat>(frame->format)), dstWidth, dstHeight, name, elapsed / iterations);
+		};
+
+	AutoReleasePtr<SwsContext, sws_freeContext> swsContext = sws_getContext(frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+		dstWidth, dstHeight, AV_PIX_FMT_BGRA, SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+	if (!swsContext)
+	{
+		av_log(nullptr, AV_LOG_ERROR, "Could not create a %dx%d -> %dx%d scaler.\n", frame->width, frame->height, dstWidth, dstHeight);
+		throw runtime_error("Could not create a scaler.");
+	}
+
+	time("swscale", [&]
+		{
+			uint8_t* dstData[4] = { dst.data() };
+			int dstLinesize[4] = { dstStride };
+			sws_scale(&*swsContext, frame->data, frame->linesize, 0, frame->height, dstData, dstLinesize);
+		});
+
+	if (!IsSupportedFormat(static_cast<AVPixelFormat>(frame->format)))
+		return results;
+
+	PreviewConverter converter;
+	auto bestKernel = converter.GetKernel();
+
+	if (bestKernel == Kernel::Avx2)
+	{
+		time("avx2", [&] { converter.Convert(frame, dst.data(), dstStride, dstWidth, dstHeight); });
+		converter.SetKernel(Kernel::Sse41);
+	}
+	if (bestKernel != Kernel::None)
+		time("sse4.1", [&] { converter.Convert(frame, dst.data(), dstStride, dstWidth, dstHeight); });
+
+	// the reference the vector kernels have to match byte for byte
+	converter.SetKernel(Kernel::Scalar);
+	time("scalar", [&] { converter.Convert(frame, dst.data(), dstStride, dstWidth, dstHeight); });
+
+	return results;
+}
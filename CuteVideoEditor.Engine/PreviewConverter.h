@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+
+// Converts decoded frames to BGRA previews, downscaling in the same pass, with SIMD kernels for the
+// formats decoders commonly hand out. Anything else is left to swscale by the caller.
+// Not thread safe, it keeps per-row scratch buffers.
+class PreviewConverter
+{
+public:
+	// Scalar is never picked on its own (swscale is faster), it's the reference the vector kernels match
+	enum class Kernel { None, Scalar, Sse41, Avx2 };
+
+	struct BenchmarkResult
+	{
+		const char* name;
+		double millisecondsPerFrame;
+	};
+
+	// picks the best kernel the CPU supports
+	PreviewConverter();
+
+	static bool IsSupportedFormat(AVPixelFormat format);
+
+	// returns false if there's no kernel for the frame, in which case nothing was written
+	bool Convert(const AVFrame* frame, uint8_t* dst, int dstStride, int dstWidth, int dstHeight);
+
+	Kernel GetKernel() const { return kernel; }
+	void SetKernel(Kernel value) { kernel = value; }
+
+	// times every kernel the CPU supports against swscale on the same frame
+	static std::vector<BenchmarkResult> Benchmark(const AVFrame* frame, int dstWidth, int dstHeight, int iterations);
+
+private:
+	Kernel kernel{};
+
+	// the source pixels and their Q14 weights making up every destination pixel along one axis: all the pixels it
+	// covers when shrinking (a box filter), the two nearest when enlarging (bilinear)
+	struct Taps
+	{
+		std::vector<int> first, offset;
+		std::vector<uint16_t> weights;
+		int srcSize{}, dstSize{};
+
+		// every destination pixel's weights again, at a fixed count padded to a multiple of 8
+		std::vector<int16_t> paddedWeights;
+		int paddedCount{};
+
+		void Build(int newSrcSize, int newDstSize);
+		int GetCount(int index) const { return offset[index + 1] - offset[index]; }
+	};
+	Taps lumaColumns, chromaColumns, lumaRows, chromaRows;
+
+	// resamples one destination row of a plane into 8-bit samples, shift is the bits above 8 per sample
+	template <typename Sample>
+	void ResampleRow(const uint8_t* plane, int linesize, int shift, const Taps& rows, const Taps& columns, int dy, uint8_t* dst);
+
+	// the same for NV12's interleaved chroma plane, into both chroma rows
+	void ResampleInterleavedRow(const uint8_t* plane, int linesize, const Taps& rows, const Taps& columns, int dy, uint8_t* dstU, uint8_t* dstV);
+
+	// one destination row worth of samples, 8 bits each, and the source width rows the vertical pass blends into
+	std::vector<uint8_t> rowY, rowU, rowV;
+	std::vector<int16_t> filteredRow, filteredRowV, interleavedRow;
+};
@@ -0,0 +1,90 @@
+#include "EngineCommon.h"
+#include "RenderQueue.h"
+
+using namespace std;
+
+size_t RenderQueue::Run()
+{
+	auto budget = threadBudget ? threadBudget : max(1u, thread::hardware_concurrency());
+	auto workerCount = clamp<size_t>(budget / threadsPerJob, 1, max<size_t>(jobs.size(), 1));
+
+	mutex jobMutex;
+	size_t nextJobIndex{}, unfinishedJobCount = jobs.size();
+	atomic<size_t> failedJobCount{};
+
+	{
+		vector<jthread> workers;
+		for (size_t workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+			workers.emplace_back([&]
+				{
+					while (true)
+					{
+						size_t jobIndex;
+						uint32_t threadCount;
+						{
+							lock_guard lock(jobMutex);
+							if (nextJobIndex == jobs.size())
+								return;
+							jobIndex = nextJobIndex++;
+
+							// once fewer jobs are left than there are workers, they split the budget between fewer encodes
+							threadCount = max(1u, static_cast<uint32_t>(budget / min(workerCount, unfinishedJobCount)));
+						}
+
+						if (!RunJob(jobIndex, threadCount))
+							++failedJobCount;
+
+						lock_guard lock(jobMutex);
+						--unfinishedJobCount;
+					}
+				});
+	}
+
+	return failedJobCount;
+}
+
+bool RenderQueue::RunJob(size_t jobIndex, uint32_t threadCount)
+{
+	auto& job = jobs[jobIndex];
+
+	// the outputs of a job encode side by side and split its share; a single encoder stops scaling past the ceiling
+	// FFmpegController defaults to, parallel segments and ladder renditions split it further
+	auto outputs = job.outputs;
+	auto outputThreadCount = max(1u, threadCount / static_cast<uint32_t>(max<size_t>(outputs.size(), 1)));
+	for (auto& output : outputs)
+	{
+		auto share = output.segmentParallel || !output.renditions.empty() ? outputThreadCount : min(outputThreadCount, 16u);
+
+		// an output asking for fewer threads than its share keeps its own count
+		output.threadCount = output.threadCount ? min(output.threadCount, share) : share;
+	}
+
+	if (jobStateCallback)
+		jobStateCallback(jobIndex, RenderQueueJobState::Running, {});
+
+	bool failed{};
+	string error;
+	try
+	{
+		Transcoder transcoder;
+		transcoder.SetProgressInterval(progressInterval);
+		if (jobProgressCallback)
+			transcoder.SetProgressCallback([&](const TranscoderProgress& progress) { jobProgressCallback(jobIndex, progress); });
+
+		transcoder.Run(job.input, outputs);
+	}
+	catch (const exception& e)
+	{
+		failed = true;
+		error = e.what();
+	}
+	catch (...)
+	{
+		failed = true;
+		error = "Unknown error.";
+	}
+
+	if (jobStateCallback)
+		jobStateCallback(jobIndex, failed ? RenderQueueJobState::Failed : RenderQueueJobState::Completed, error);
+	return !failed;
+}
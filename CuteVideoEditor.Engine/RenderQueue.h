@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Transcoder.h"
+
+// one project, with one or more outputs sharing its decode
+struct RenderQueueJob
+{
+	TranscoderInput input;
+	std::vector<TranscoderOutput> outputs;
+};
+
+enum class RenderQueueJobState
+{
+	Queued,
+	Running,
+	Completed,
+	Failed,
+};
+
+// Runs many exports on one thread budget: as many jobs run at once as the budget has room for, each with its
+// share of the cores, so a batch of short clips that can't scale an encoder over the whole machine still keeps
+// it loaded. Jobs started near the end of a batch, with fewer jobs left than workers, get bigger shares.
+class RenderQueue
+{
+public:
+	// both callbacks come from the worker and progress threads of the jobs, so several jobs report at once
+	using JobProgressCallback = std::function<void(size_t jobIndex, const TranscoderProgress& progress)>;
+
+	// the error is the exception message of a failed job, empty otherwise
+	using JobStateCallback = std::function<void(size_t jobIndex, RenderQueueJobState state, const std::string& error)>;
+
+	// the threads shared by every job, 0 for the whole machine
+	void SetThreadBudget(uint32_t threadCount) { threadBudget = threadCount; }
+
+	// the fewest threads a job runs with, which caps how many jobs run at once
+	void SetThreadsPerJob(uint32_t threadCount) { threadsPerJob = std::max(threadCount, 1u); }
+
+	void SetProgressInterval(MediaTime interval) { progressInterval = interval; }
+	void SetJobProgressCallback(JobProgressCallback callback) { jobProgressCallback = std::move(callback); }
+	void SetJobStateCallback(JobStateCallback callback) { jobStateCallback = std::move(callback); }
+
+	size_t AddJob(RenderQueueJob job) { jobs.push_back(std::move(job)); return jobs.size() - 1; }
+	size_t GetJobCount() const { return jobs.size(); }
+
+	// a failing job doesn't stop the others; returns how many failed
+	size_t Run();
+
+private:
+	bool RunJob(size_t jobIndex, uint32_t threadCount);
+
+	std::vector<RenderQueueJob> jobs;
+	uint32_t threadBudget{};
+	uint32_t threadsPerJob = 4;
+
+	MediaTime progressInterval{ std::chrono::milliseconds(500) };
+	JobProgressCallback jobProgressCallback;
+	JobStateCallback jobStateCallback;
+};
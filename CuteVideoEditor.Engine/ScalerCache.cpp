@@ -0,0 +1,36 @@
+#include "EngineCommon.h"
+#include "ScalerCache.h"
+
+using namespace std;
+
+SwsContext* ScalerCache::Get(const Key& key)
+{
+	if (auto it = entryIndex.find(key); it != entryIndex.end())
+	{
+		++hitCount;
+		entries.splice(entries.begin(), entries, it->second);
+		return &*it->second->second;
+	}
+
+	++missCount;
+
+	AutoReleasePtr<SwsContext, sws_freeContext> swsContext = sws_getContext(
+		key.srcWidth, key.srcHeight, key.srcFormat,
+		key.dstWidth, key.dstHeight, key.dstFormat,
+		key.flags, nullptr, nullptr, nullptr);
+	if (!swsContext)
+	{
+		av_log(nullptr, AV_LOG_ERROR, "Could not create a %dx%d -> %dx%d scaler.\n", key.srcWidth, key.srcHeight, key.dstWidth, key.dstHeight);
+		throw runtime_error("Could not create a scaler.");
+	}
+
+	if (entries.size() >= capacity)
+	{
+		entryIndex.erase(entries.back().first);
+		entries.pop_back();
+	}
+
+	entries.emplace_front(key, move(swsContext));
+	entryIndex.emplace(key, entries.begin());
+	return &*entries.front().second;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <list>
+#include <map>
+
+// Least recently used cache of swscale contexts, keyed by every parameter that goes into building one.
+// Not thread safe, each pipeline stage owns its own cache.
+class ScalerCache
+{
+public:
+	struct Key
+	{
+		int srcWidth, srcHeight;
+		AVPixelFormat srcFormat;
+		int dstWidth, dstHeight;
+		AVPixelFormat dstFormat;
+		int flags;
+
+		auto operator<=>(const Key&) const = default;
+	};
+
+	explicit ScalerCache(size_t capacity) : capacity(capacity) { }
+
+	SwsContext* Get(const Key& key);
+
+	uint64_t GetHitCount() const { return hitCount; }
+	uint64_t GetMissCount() const { return missCount; }
+
+private:
+	using Entry = std::pair<Key, AutoReleasePtr<SwsContext, sws_freeContext>>;
+
+	// most recently used first
+	std::list<Entry> entries;
+	std::map<Key, std::list<Entry>::iterator> entryIndex;
+	size_t capacity;
+
+	uint64_t hitCount{}, missCount{};
+};
@@ -0,0 +1,364 @@
+#include "EngineCommon.h"
+#include "Transcoder.h"
+
+#include <asyncpp/scope_guard.h>
+
+#include <random>
+
+using namespace std;
+using namespace chrono;
+
+void Transcoder::Run(const TranscoderInput& input, const TranscoderOutput& output)
+{
+	Run(input, vector{ output });
+}
+
+void Transcoder::Run(const TranscoderInput& input, const vector<TranscoderOutput>& outputs)
+{
+	if (outputs.empty())
+		throw invalid_argument("An export needs at least one output.");
+
+	ffmpegController = make_unique<FFmpegController>();
+	asyncpp::scope_guard releaseController([&]() noexcept { ffmpegController.reset(); });
+
+	// every controller of this run counts into the same stats
+	FFmpegControllerPipelineStats stats;
+	pipelineStats = &stats;
+	ffmpegController->SetPipelineStats(stats);
+	asyncpp::scope_guard clearPipelineStats([&]() noexcept { pipelineStats = nullptr; });
+	totalFrameCount = 0;
+
+	// sampled on a thread of its own, so the pipeline never waits on the subscribers
+	auto startTime = steady_clock::now();
+	auto previousTime = startTime;
+	int64_t previousDecodedFrameCount{}, previousFilteredFrameCount{}, previousEncodedFrameCount{};
+	bool previousAnalyzingScenes{};
+	auto reportProgress = [&]
+		{
+			if (!progressCallback)
+				return;
+
+			auto now = steady_clock::now();
+			auto seconds = max(duration<double>(now - previousTime).count(), 1e-3);
+
+			TranscoderProgress progress;
+			progress.analyzingScenes = analyzingScenes;
+			progress.totalFrameCount = totalFrameCount;
+			progress.decodedFrameCount = stats.decodedFrameCount;
+			progress.filteredFrameCount = stats.filteredFrameCount;
+			progress.encodedFrameCount = stats.encodedFrameCount;
+
+			// the decode count starts over when the scene analysis hands over to the export
+			if (progress.analyzingScenes != previousAnalyzingScenes)
+				previousDecodedFrameCount = 0;
+			progress.decodeFps = max<int64_t>(progress.decodedFrameCount - previousDecodedFrameCount, 0) / seconds;
+			progress.filterFps = (progress.filteredFrameCount - previousFilteredFrameCount) / seconds;
+			progress.encodeFps = (progress.encodedFrameCount - previousEncodedFrameCount) / seconds;
+			progress.decodedQueueDepth = stats.decodedQueueDepth;
+			progress.filteredQueueDepth = stats.filteredQueueDepth;
+			progress.bytesWritten = stats.bytesWritten;
+			progress.elapsed = duration_cast<MediaTime>(now - startTime);
+
+			// from the average rate so far, the per interval rates are too noisy
+			if (progress.encodedFrameCount > 0 && progress.totalFrameCount > progress.encodedFrameCount)
+				progress.eta = duration_cast<MediaTime>(progress.elapsed * (progress.totalFrameCount - progress.encodedFrameCount) / progress.encodedFrameCount);
+
+			previousTime = now;
+			previousAnalyzingScenes = progress.analyzingScenes;
+			previousDecodedFrameCount = progress.decodedFrameCount;
+			previousFilteredFrameCount = progress.filteredFrameCount;
+			previousEncodedFrameCount = progress.encodedFrameCount;
+
+			progressCallback(progress);
+		};
+
+	jthread progressThread([&, interval = progressInterval](stop_token stopToken)
+		{
+			mutex progressMutex;
+			condition_variable_any progressCondition;
+			unique_lock lock(progressMutex);
+			while (!progressCondition.wait_for(lock, stopToken, interval, [] { return false; }) && !stopToken.stop_requested())
+				reportProgress();
+		});
+
+	if (outputs.size() == 1)
+		RunTranscode(input, outputs.front());
+	else
+		RunSharedDecode(input, outputs);
+
+	progressThread.request_stop();
+	progressThread.join();
+	reportProgress();
+}
+
+void Transcoder::PlanKeyframes(const TranscoderInput& input, uint32_t threadCount)
+{
+	FFmpegController analysisController;
+	analysisController.SetDecoderThreadCount(threadCount);
+	analysisController.SetPipelineStats(*pipelineStats);
+	analysisController.OpenInputVideo(input.fileNameUtf8.c_str(), false);
+	analysisController.SetValidTrimmingRanges(input.trimmingMarkers);
+
+	// a whole extra decode, reported as such so long exports don't sit at 0% while it runs
+	auto exportFrameCount = totalFrameCount.exchange(analysisController.GetOutputFrameCount());
+	analyzingScenes = true;
+	asyncpp::scope_guard endAnalysis([&]() noexcept
+		{
+			pipelineStats->decodedFrameCount = 0;
+			totalFrameCount = exportFrameCount;
+			analyzingScenes = false;
+		});
+
+	ffmpegController->SetKeyframePlan(analysisController.AnalyzeScenes());
+}
+
+void Transcoder::RunTranscode(const TranscoderInput& input, const TranscoderOutput& output)
+{
+	ffmpegController->SetDecoderThreadCount(output.threadCount);
+	ffmpegController->SetEncoderThreadCount(output.threadCount);
+	// segment workers seek to their first frame exactly with the scanned index, which they share
+	ffmpegController->OpenInputVideo(input.fileNameUtf8.c_str(), true, output.segmentParallel || output.smartRender);
+	ffmpegController->SetValidTrimmingRanges(input.trimmingMarkers);
+	ffmpegController->SetRateControl(output.rateControl, output.bitrateKbps);
+	ffmpegController->SetFrameRateMultiplier(output.frameRateMultiplier);
+
+	// two pass encodes go through every frame twice
+	totalFrameCount = ffmpegController->GetOutputFrameCount() * (output.rateControl == FFmpegControllerRateControlMode::TwoPass ? 2 : 1);
+
+	if (output.sceneDetection)
+		PlanKeyframes(input, output.threadCount);
+
+	if (!output.renditions.empty())
+	{
+		RunLadder(input, output);
+		return;
+	}
+
+	if (output.rateControl == FFmpegControllerRateControlMode::TwoPass)
+	{
+		if (output.smartRender || output.segmentParallel)
+			av_log(nullptr, AV_LOG_INFO, "Two pass encodes need every frame in one encoder, encoding sequentially.\n");
+
+		RunTwoPass(input, output);
+		return;
+	}
+
+	if (output.smartRender)
+	{
+		if (ffmpegController->CanStreamCopy(output.type, output.width, output.height, input.cropFrames))
+		{
+			RunSegments(input, output, ffmpegController->GetSmartRenderSegments(), true);
+			return;
+		}
+
+		av_log(nullptr, AV_LOG_INFO, "The output needs a crop, resize or codec change, re-encoding every frame.\n");
+	}
+
+	if (output.segmentParallel)
+	{
+		RunSegments(input, output, ffmpegController->GetExportSegments(), false);
+		return;
+	}
+
+	ffmpegController->OpenOutputVideo(output.fileNameUtf8.c_str(), output.type, output.crf, output.preset, output.width, output.height,
+		input.encoderTitleUtf8.c_str(), input.cropFrames, true);
+
+	uint64_t encodedFrameIndex = 0;
+	ffmpegController->RunEncodingPipeline([&](AVFrame* frame) { OnFrame(*ffmpegController, frame, encodedFrameIndex++); });
+	ffmpegController->CloseOutputs();
+}
+
+void Transcoder::RunLadder(const TranscoderInput& input, const TranscoderOutput& output)
+{
+	if (output.rateControl != FFmpegControllerRateControlMode::Crf || output.smartRender || output.segmentParallel)
+		throw invalid_argument("Ladders cap each rendition on its own and encode every frame in a single pass.");
+
+	// every rendition is one more encode of each frame
+	totalFrameCount = ffmpegController->GetOutputFrameCount() * static_cast<int64_t>(output.renditions.size());
+
+	auto renditionCount = static_cast<int>(output.renditions.size());
+	ffmpegController->SetEncoderThreadCount(output.threadCount
+		? max(1, static_cast<int>(output.threadCount) / renditionCount)
+		: clamp(static_cast<int>(thread::hardware_concurrency()) / renditionCount, 1, 16));
+	ffmpegController->OpenOutputLadder(output.fileNameUtf8.c_str(), output.type, output.preset, output.renditions, output.segmentDuration,
+		input.encoderTitleUtf8.c_str(), input.cropFrames, true);
+
+	uint64_t encodedFrameIndex = 0;
+	ffmpegController->RunEncodingPipeline([&](AVFrame* frame) { OnFrame(*ffmpegController, frame, encodedFrameIndex++); });
+	ffmpegController->CloseOutputs();
+}
+
+void Transcoder::RunSharedDecode(const TranscoderInput& input, const vector<TranscoderOutput>& outputs)
+{
+	for (auto& output : outputs)
+		if (output.rateControl == FFmpegControllerRateControlMode::TwoPass || output.smartRender || output.segmentParallel
+			|| !output.renditions.empty())
+			throw invalid_argument("Two pass, smart render, parallel segment and ladder exports can't share their decode with other outputs.");
+
+	// the encoders run side by side, so without a budget of their own they split the machine between them
+	auto sharedThreadCount = clamp(static_cast<int>(thread::hardware_concurrency() / outputs.size()), 1, 16);
+
+	ffmpegController->SetDecoderThreadCount(outputs.front().threadCount);
+	ffmpegController->OpenInputVideo(input.fileNameUtf8.c_str(), true);
+	ffmpegController->SetValidTrimmingRanges(input.trimmingMarkers);
+	totalFrameCount = ffmpegController->GetOutputFrameCount() * static_cast<int64_t>(outputs.size());
+
+	// one keyframe plan for every output, so their keyframes stay on the same frames
+	if (ranges::any_of(outputs, [](auto& output) { return output.sceneDetection; }))
+		PlanKeyframes(input, outputs.front().threadCount);
+
+	for (auto& output : outputs)
+	{
+		ffmpegController->SetRateControl(output.rateControl, output.bitrateKbps);
+		ffmpegController->SetFrameRateMultiplier(output.frameRateMultiplier);
+		ffmpegController->SetEncoderThreadCount(output.threadCount ? static_cast<int>(output.threadCount) : sharedThreadCount);
+		ffmpegController->OpenOutputVideo(output.fileNameUtf8.c_str(), output.type, output.crf, output.preset, output.width, output.height,
+			input.encoderTitleUtf8.c_str(), input.cropFrames, true);
+	}
+
+	uint64_t encodedFrameIndex = 0;
+	ffmpegController->RunEncodingPipeline([&](AVFrame* frame) { OnFrame(*ffmpegController, frame, encodedFrameIndex++); });
+	ffmpegController->CloseOutputs();
+}
+
+void Transcoder::RunTwoPass(const TranscoderInput& input, const TranscoderOutput& output)
+{
+	// x264 and x265 write their statistics to a file, with side files for their macroblock trees; jobs running at once,
+	// in this process or another, may export files of the same name, so the name hashes the full output path and
+	// adds a per-process random tag and a per-job counter
+	static const auto processTag = random_device{}();
+	static atomic<uint32_t> twoPassJobCounter;
+	error_code pathError;
+	auto outputPath = filesystem::absolute(PathFromUtf8(output.fileNameUtf8), pathError);
+	auto statsPath = filesystem::temp_directory_path() / PathFromUtf8(format("cve-{:016x}-{:08x}-{}.passlog",
+		hash<string>{}(PathToUtf8(pathError ? PathFromUtf8(output.fileNameUtf8) : outputPath)), processTag, twoPassJobCounter++));
+	auto statsFileNameUtf8 = PathToUtf8(statsPath);
+	asyncpp::scope_guard removeStats([&]() noexcept
+		{
+			error_code ec;
+			for (auto extension : { "", ".mbtree", ".cutree", ".temp" })
+				filesystem::remove(PathFromUtf8(statsFileNameUtf8 + extension), ec);
+		});
+
+	// analysis pass, on its own controller so the real encode starts from a freshly opened input
+	string twoPassStats;
+	{
+		FFmpegController analysisController;
+		analysisController.SetDecoderThreadCount(output.threadCount);
+		analysisController.SetEncoderThreadCount(output.threadCount);
+		analysisController.OpenInputVideo(input.fileNameUtf8.c_str(), false);
+		analysisController.SetValidTrimmingRanges(input.trimmingMarkers);
+		analysisController.SetRateControl(output.rateControl, output.bitrateKbps);
+		analysisController.SetFrameRateMultiplier(output.frameRateMultiplier);
+		analysisController.SetEncodingPass(1, statsFileNameUtf8);
+		analysisController.SetKeyframePlan(ffmpegController->GetKeyframePlan());
+		analysisController.SetPipelineStats(*pipelineStats);
+		analysisController.OpenOutputVideo(output.fileNameUtf8.c_str(), output.type, output.crf, output.preset, output.width, output.height,
+			input.encoderTitleUtf8.c_str(), input.cropFrames, false);
+
+		uint64_t analyzedFrameIndex = 0;
+		analysisController.RunEncodingPipeline([&](AVFrame* frame) { OnFrame(analysisController, frame, analyzedFrameIndex++); });
+		analysisController.CloseOutputs();
+		twoPassStats = analysisController.GetTwoPassStats();
+	}
+
+	ffmpegController->SetEncodingPass(2, statsFileNameUtf8, move(twoPassStats));
+	ffmpegController->OpenOutputVideo(output.fileNameUtf8.c_str(), output.type, output.crf, output.preset, output.width, output.height,
+		input.encoderTitleUtf8.c_str(), input.cropFrames, true);
+
+	uint64_t encodedFrameIndex = 0;
+	ffmpegController->RunEncodingPipeline([&](AVFrame* frame) { OnFrame(*ffmpegController, frame, encodedFrameIndex++); });
+	ffmpegController->CloseOutputs();
+}
+
+void Transcoder::RunSegments(const TranscoderInput& input, const TranscoderOutput& output,
+	const vector<FFmpegControllerExportSegment>& segments, bool smartRender)
+{
+	// every segment is written next to the output file, in the same container
+	auto outputPath = PathFromUtf8(output.fileNameUtf8);
+	vector<filesystem::path> segmentPaths;
+	vector<string> segmentFileNamesUtf8;
+	for (size_t segmentIndex = 0; segmentIndex < segments.size(); ++segmentIndex)
+	{
+		auto segmentPath = outputPath;
+		segmentPath.replace_extension(PathFromUtf8(format(".part{}{}", segmentIndex, PathToUtf8(outputPath.extension()))));
+		segmentFileNamesUtf8.push_back(PathToUtf8(segmentPath));
+		segmentPaths.push_back(move(segmentPath));
+	}
+
+	asyncpp::scope_guard removeSegments([&]() noexcept
+		{
+			error_code ec;
+			for (auto& segmentPath : segmentPaths)
+				filesystem::remove(segmentPath, ec);
+		});
+
+	// split the thread budget between the concurrently running encoders, a sequential export without a budget
+	// keeps the default thread counts
+	auto threadBudget = output.threadCount ? output.threadCount : max(1u, thread::hardware_concurrency());
+	auto workerCount = output.segmentParallel ? clamp<size_t>(threadBudget / 4, 1, max<size_t>(segments.size(), 1)) : 1;
+	auto workerThreadCount = output.segmentParallel || output.threadCount ? max(1, (int)(threadBudget / workerCount)) : 0;
+
+	atomic<size_t> nextSegmentIndex{};
+	atomic<uint64_t> encodedFrameIndex{};
+	atomic<bool> failed{};
+	exception_ptr workerException;
+	mutex workerExceptionMutex;
+
+	{
+		vector<jthread> workers;
+		for (size_t workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+			workers.emplace_back([&]
+				{
+					try
+					{
+						for (size_t segmentIndex; !failed && (segmentIndex = nextSegmentIndex++) < segments.size(); )
+						{
+							auto& segment = segments[segmentIndex];
+
+							FFmpegController segmentController;
+							segmentController.SetDecoderThreadCount(output.threadCount ? workerThreadCount : 0);
+							segmentController.OpenInputVideo(input.fileNameUtf8.c_str(), false);
+							segmentController.SharePacketIndex(*ffmpegController);
+
+							if (segment.streamCopy)
+							{
+								segmentController.StreamCopySegment(segment.start, segment.end, segmentFileNamesUtf8[segmentIndex].c_str(), input.encoderTitleUtf8.c_str());
+								encodedFrameIndex += segment.frameCount;
+								pipelineStats->encodedFrameCount += segment.frameCount;
+								pipelineStats->bytesWritten += static_cast<int64_t>(filesystem::file_size(segmentPaths[segmentIndex]));
+								continue;
+							}
+
+							segmentController.SetMatchSourceEncoding(smartRender);
+							segmentController.SetRateControl(output.rateControl, output.bitrateKbps);
+							segmentController.SetFrameRateMultiplier(output.frameRateMultiplier);
+							segmentController.SetKeyframePlan(ffmpegController->GetKeyframePlan());
+							segmentController.SetPipelineStats(*pipelineStats);
+							segmentController.SetValidTrimmingRange(segment.start, segment.end);
+							segmentController.SetOutputFrameOffset(segment.outputFrameOffset);
+							segmentController.SetEncoderThreadCount(workerThreadCount);
+							segmentController.OpenOutputVideo(segmentFileNamesUtf8[segmentIndex].c_str(),
+								output.type, output.crf, output.preset, output.width, output.height,
+								input.encoderTitleUtf8.c_str(), input.cropFrames, false);
+
+							segmentController.RunEncodingPipeline([&](AVFrame* frame) { OnFrame(segmentController, frame, encodedFrameIndex++); });
+							segmentController.CloseOutputs();
+						}
+					}
+					catch (...)
+					{
+						lock_guard lock(workerExceptionMutex);
+						if (!workerException)
+							workerException = current_exception();
+						failed = true;
+					}
+				});
+	}
+
+	if (workerException)
+		rethrow_exception(workerException);
+
+	// join the segment bitstreams without re-encoding
+	ffmpegController->ConcatenateOutputVideos(segmentFileNamesUtf8, output.fileNameUtf8.c_str(), input.encoderTitleUtf8.c_str(), true);
+}
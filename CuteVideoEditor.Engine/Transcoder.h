@@ -0,0 +1,89 @@
+#pragma once
+
+#include "FFmpegController.h"
+
+// the source of an export, with its crop and trimming in input frame numbers
+struct TranscoderInput
+{
+	std::string fileNameUtf8;
+	std::vector<FFmpegControllerCropFrame> cropFrames;
+	std::vector<FFmpegControllerTrimmingMarker> trimmingMarkers;
+	std::string encoderTitleUtf8;
+};
+
+struct TranscoderOutput
+{
+	std::string fileNameUtf8;
+	FFmpegControllerOutputType type{};
+	uint32_t crf{};
+	FFmpegControllerPresetType preset{ FFmpegControllerPresetType::Medium };
+	uint32_t width{}, height{};
+	double frameRateMultiplier = 1;
+	bool segmentParallel{};
+	bool smartRender{};
+	FFmpegControllerRateControlMode rateControl{ FFmpegControllerRateControlMode::Crf };
+	uint32_t bitrateKbps{};
+	bool sceneDetection{};
+
+	// an adaptive bitrate ladder instead of a single video when set: fileNameUtf8 is then the DASH manifest, and
+	// width, height and crf give way to the renditions' own
+	std::vector<FFmpegControllerRendition> renditions;
+	MediaTime segmentDuration{ std::chrono::seconds(4) };
+
+	// the cores this export may use for decoding and encoding, 0 for the whole machine; a render queue running
+	// several exports at once hands each its share
+	uint32_t threadCount{};
+};
+
+// one progress sample, the rates are over the interval since the previous sample; while the scenes are analyzed
+// ahead of the export only the decoded frames count, out of the total
+struct TranscoderProgress
+{
+	bool analyzingScenes{};
+	int64_t totalFrameCount{}, decodedFrameCount{}, filteredFrameCount{}, encodedFrameCount{};
+	double decodeFps{}, filterFps{}, encodeFps{};
+	int64_t decodedQueueDepth{}, filteredQueueDepth{};
+	int64_t bytesWritten{};
+	MediaTime elapsed{}, eta{};
+};
+
+// Runs a whole export: scene analysis, smart rendering, parallel segments and two pass encodes on top of
+// FFmpegController, reporting progress on a timer. The WinRT Transcode and the command line both drive this.
+class Transcoder
+{
+public:
+	using ProgressCallback = std::function<void(const TranscoderProgress&)>;
+
+	// every frame going into the encoders, on the thread that decoded it, with the controller that decoded it;
+	// parallel segments call this from several threads at once
+	using FrameCallback = std::function<void(FFmpegController& controller, AVFrame* frame, uint64_t frameIndex)>;
+
+	void SetProgressInterval(MediaTime interval) { progressInterval = interval; }
+	void SetProgressCallback(ProgressCallback callback) { progressCallback = std::move(callback); }
+	void SetFrameCallback(FrameCallback callback) { frameCallback = std::move(callback); }
+
+	void Run(const TranscoderInput& input, const TranscoderOutput& output);
+
+	// several outputs of the same input from one decode and crop, each with its own size, codec and muxer; two pass,
+	// smart render and parallel segment exports decode on their own and can't be among them
+	void Run(const TranscoderInput& input, const std::vector<TranscoderOutput>& outputs);
+
+private:
+	void PlanKeyframes(const TranscoderInput& input, uint32_t threadCount);
+	void RunTranscode(const TranscoderInput& input, const TranscoderOutput& output);
+	void RunSharedDecode(const TranscoderInput& input, const std::vector<TranscoderOutput>& outputs);
+	void RunLadder(const TranscoderInput& input, const TranscoderOutput& output);
+	void RunTwoPass(const TranscoderInput& input, const TranscoderOutput& output);
+	void RunSegments(const TranscoderInput& input, const TranscoderOutput& output,
+		const std::vector<FFmpegControllerExportSegment>& segments, bool smartRender);
+	void OnFrame(FFmpegController& controller, AVFrame* frame, uint64_t frameIndex) { if (frameCallback) frameCallback(controller, frame, frameIndex); }
+
+	std::unique_ptr<FFmpegController> ffmpegController;
+	FFmpegControllerPipelineStats* pipelineStats{};
+	std::atomic<int64_t> totalFrameCount{};
+	std::atomic<bool> analyzingScenes{};
+
+	MediaTime progressInterval{ std::chrono::milliseconds(500) };
+	ProgressCallback progressCallback;
+	FrameCallback frameCallback;
+};
@@ -0,0 +1,101 @@
+#include "EngineCommon.h"
+#include "BoundedQueue.h"
+
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace chrono;
+
+TEST(BoundedQueue, PopsInOrder)
+{
+	BoundedQueue<int> queue(4);
+	for (int i = 0; i < 4; ++i)
+		ASSERT_TRUE(queue.Push(int{ i }));
+	EXPECT_EQ(queue.Size(), 4u);
+
+	for (int i = 0; i < 4; ++i)
+	{
+		int item;
+		ASSERT_TRUE(queue.Pop(item));
+		EXPECT_EQ(item, i);
+	}
+	EXPECT_EQ(queue.Size(), 0u);
+}
+
+TEST(BoundedQueue, CloseDrainsRemainingItems)
+{
+	BoundedQueue<int> queue(4);
+	queue.Push(1);
+	queue.Push(2);
+	queue.Close();
+
+	// no more items in, but what's queued still comes out
+	EXPECT_FALSE(queue.Push(3));
+
+	int item;
+	ASSERT_TRUE(queue.Pop(item));
+	EXPECT_EQ(item, 1);
+	ASSERT_TRUE(queue.Pop(item));
+	EXPECT_EQ(item, 2);
+	EXPECT_FALSE(queue.Pop(item));
+}
+
+TEST(BoundedQueue, AbortDropsItems)
+{
+	BoundedQueue<int> queue(4);
+	queue.Push(1);
+	queue.Abort();
+
+	int item;
+	EXPECT_FALSE(queue.Pop(item));
+	EXPECT_FALSE(queue.Push(2));
+	EXPECT_EQ(queue.Size(), 0u);
+}
+
+TEST(BoundedQueue, PushBlocksWhileFull)
+{
+	BoundedQueue<int> queue(1);
+	queue.Push(1);
+
+	atomic<bool> pushed{};
+	jthread producer([&] { pushed = queue.Push(2); });
+	this_thread::sleep_for(milliseconds(50));
+	EXPECT_FALSE(pushed);
+
+	int item;
+	ASSERT_TRUE(queue.Pop(item));
+	EXPECT_EQ(item, 1);
+	producer.join();
+	EXPECT_TRUE(pushed);
+
+	ASSERT_TRUE(queue.Pop(item));
+	EXPECT_EQ(item, 2);
+}
+
+TEST(BoundedQueue, CloseReleasesBlockedConsumers)
+{
+	BoundedQueue<int> queue(1);
+
+	atomic<bool> popped{ true };
+	jthread consumer([&] { int item; popped = queue.Pop(item); });
+	this_thread::sleep_for(milliseconds(50));
+	queue.Close();
+	consumer.join();
+
+	EXPECT_FALSE(popped);
+}
+
+TEST(BoundedQueue, AbortReleasesBlockedProducers)
+{
+	BoundedQueue<int> queue(1);
+	queue.Push(1);
+
+	atomic<bool> pushed{ true };
+	jthread producer([&] { pushed = queue.Push(2); });
+	this_thread::sleep_for(milliseconds(50));
+	queue.Abort();
+	producer.join();
+
+	EXPECT_FALSE(pushed);
+	EXPECT_EQ(queue.Size(), 0u);
+}
@@ -0,0 +1,111 @@
+#include "EngineCommon.h"
+#include "DecodedFrameCache.h"
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+namespace
+{
+	// a 64x64 yuv420p frame, with buffers so the cache has bytes to count
+	AutoReleasePtr<AVFrame, av_frame_free> MakeFrame(int64_t pts)
+	{
+		AutoReleasePtr<AVFrame, av_frame_free> frame = av_frame_alloc();
+		frame->width = frame->height = 64;
+		frame->format = AV_PIX_FMT_YUV420P;
+		frame->best_effort_timestamp = pts;
+		if (av_frame_get_buffer(&*frame, 0) < 0)
+			throw bad_alloc();
+		return frame;
+	}
+
+	size_t GetFrameByteSize()
+	{
+		size_t byteSize = 0;
+		auto frame = MakeFrame(0);
+		for (auto buffer : frame->buf)
+			if (buffer)
+				byteSize += buffer->size;
+		return byteSize;
+	}
+}
+
+TEST(DecodedFrameCache, FindsClosestFrameWithinTolerance)
+{
+	DecodedFrameCache cache(64 * 1024 * 1024);
+	for (auto pts : { 0, 100, 200 })
+		cache.Add(&*MakeFrame(pts));
+
+	ASSERT_NE(cache.Find(100, 0), nullptr);
+	EXPECT_EQ(cache.Find(100, 0)->best_effort_timestamp, 100);
+	EXPECT_EQ(cache.Find(140, 50)->best_effort_timestamp, 100);
+	EXPECT_EQ(cache.Find(160, 50)->best_effort_timestamp, 200);
+	EXPECT_EQ(cache.Find(150, 10), nullptr);
+	EXPECT_EQ(cache.Find(-100, 50), nullptr);
+}
+
+TEST(DecodedFrameCache, IgnoresFramesWithoutTimestamp)
+{
+	DecodedFrameCache cache(64 * 1024 * 1024);
+	cache.Add(&*MakeFrame(AV_NOPTS_VALUE));
+	EXPECT_EQ(cache.GetByteSize(), 0u);
+}
+
+TEST(DecodedFrameCache, AddingTheSameFrameTwiceCountsOnce)
+{
+	DecodedFrameCache cache(64 * 1024 * 1024);
+	cache.Add(&*MakeFrame(100));
+	cache.Add(&*MakeFrame(100));
+	EXPECT_EQ(cache.GetByteSize(), GetFrameByteSize());
+}
+
+TEST(DecodedFrameCache, EvictsLeastRecentlyUsedOverBudget)
+{
+	auto frameByteSize = GetFrameByteSize();
+	DecodedFrameCache cache(frameByteSize * 2);
+	cache.Add(&*MakeFrame(0));
+	cache.Add(&*MakeFrame(100));
+
+	// 0 is used again, so 100 goes when 200 comes in
+	EXPECT_NE(cache.Find(0, 0), nullptr);
+	cache.Add(&*MakeFrame(200));
+
+	EXPECT_EQ(cache.GetByteSize(), frameByteSize * 2);
+	EXPECT_NE(cache.Find(0, 0), nullptr);
+	EXPECT_EQ(cache.Find(100, 0), nullptr);
+	EXPECT_NE(cache.Find(200, 0), nullptr);
+}
+
+TEST(DecodedFrameCache, ShrinkingTheBudgetEvicts)
+{
+	auto frameByteSize = GetFrameByteSize();
+	DecodedFrameCache cache(frameByteSize * 4);
+	for (auto pts : { 0, 100, 200, 300 })
+		cache.Add(&*MakeFrame(pts));
+
+	cache.SetByteBudget(frameByteSize);
+	EXPECT_EQ(cache.GetByteSize(), frameByteSize);
+	EXPECT_NE(cache.Find(300, 0), nullptr);
+
+	cache.Clear();
+	EXPECT_EQ(cache.GetByteSize(), 0u);
+	EXPECT_EQ(cache.Find(300, 0), nullptr);
+}
+
+TEST(DecodedFrameCache, AddingAFrameAgainMarksItUsed)
+{
+	auto frameByteSize = GetFrameByteSize();
+	DecodedFrameCache cache(frameByteSize * 3);
+	for (auto pts : { 0, 100, 200 })
+		cache.Add(&*MakeFrame(pts));
+
+	// decoding over 0 again keeps it, so 100 goes when 300 comes in
+	cache.Add(&*MakeFrame(0));
+	cache.Add(&*MakeFrame(300));
+
+	EXPECT_EQ(cache.GetByteSize(), frameByteSize * 3);
+	EXPECT_NE(cache.Find(0, 0), nullptr);
+	EXPECT_EQ(cache.Find(100, 0), nullptr);
+	EXPECT_NE(cache.Find(200, 0), nullptr);
+	EXPECT_NE(cache.Find(300, 0), nullptr);
+}
@@ -0,0 +1,285 @@
+#include "EngineCommon.h"
+#include "FFmpegController.h"
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+// sets up an input's timing and packet index the way OpenInputVideo would, without a media file
+struct FFmpegControllerTestAccess
+{
+	static constexpr int timeBase = 15360, frameRate = 30, ticksPerFrame = timeBase / frameRate;
+
+	// frameCount frames without B-frames, a keyframe every gopSize frames
+	static void OpenInput(FFmpegController& controller, int64_t frameCount, int64_t gopSize)
+	{
+		controller.inputFormatContext = avformat_alloc_context();
+		controller.inputVideoStream = avformat_new_stream(&*controller.inputFormatContext, nullptr);
+		controller.inputVideoStream->time_base = { 1, timeBase };
+		controller.inputCodecContext = avcodec_alloc_context3(nullptr);
+		controller.frameRate = frameRate;
+		controller.mediaDuration = MediaTimeFromSeconds(static_cast<double>(frameCount) / frameRate);
+
+		for (int64_t frameNumber = 0; frameNumber < frameCount; ++frameNumber)
+		{
+			auto keyframe = frameNumber % gopSize == 0;
+			if (keyframe)
+				controller.ownedKeyframePacketIndices.push_back(controller.ownedPacketIndex.size());
+			controller.ownedPacketIndex.push_back({ frameNumber * ticksPerFrame, frameNumber * ticksPerFrame, frameNumber * 1000, 1000, keyframe });
+		}
+		controller.packetIndex = controller.ownedPacketIndex;
+		controller.keyframePacketIndices = controller.ownedKeyframePacketIndices;
+		controller.BuildFrameTimestampMap();
+	}
+
+	// runs the trimming ranges through the frame enumerator like the encoding pipeline does, returning the frames handed out
+	static int64_t EnumerateFrames(FFmpegController& controller)
+	{
+		int64_t frameCount = 0;
+		for (auto frame : controller.EnumerateInputFrames())
+		{
+			if (!frame)
+				break;
+			++frameCount;
+		}
+		return frameCount;
+	}
+
+	// the number of the next frame the decoder would hand out
+	static int64_t GetDecodedFrameNumber(const FFmpegController& controller) { return controller.inputFrameNumber; }
+
+	// frames SeekToFrame can land on exactly
+	static size_t GetIndexedFrameCount(const FFmpegController& controller) { return controller.framePresentationTimestamps.size(); }
+};
+
+namespace
+{
+	constexpr int clipFrameRate = 25;
+
+	// a short MPEG-4 Part 2 clip in Matroska, which every FFmpeg build can write, removed again with the test
+	struct TestClip
+	{
+		filesystem::path path = filesystem::temp_directory_path()
+			/ format("cve-engine-tests-{}.mkv", testing::UnitTest::GetInstance()->current_test_info()->name());
+
+		TestClip(int frameCount, int gopSize) { Write(frameCount, gopSize); }
+		~TestClip() { error_code ec; filesystem::remove(path, ec); }
+
+		string GetPathUtf8() const { return PathToUtf8(path); }
+		static MediaTime GetFramePosition(int64_t frameNumber) { return MediaTimeFromSeconds(static_cast<double>(frameNumber) / clipFrameRate); }
+
+	private:
+		// every frame a different gray, a keyframe every gopSize frames and no B-frames
+		void Write(int frameCount, int gopSize)
+		{
+			auto pathUtf8 = GetPathUtf8();
+			AutoReleasePtr<AVFormatContext, avformat_free_context> formatContext;
+			ASSERT_GE(avformat_alloc_output_context2(&formatContext, nullptr, "matroska", pathUtf8.c_str()), 0);
+
+			auto codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+			ASSERT_NE(codec, nullptr);
+			AutoReleasePtr<AVCodecContext, avcodec_free_context> codecContext = avcodec_alloc_context3(codec);
+			ASSERT_TRUE(codecContext);
+			codecContext->width = 64;
+			codecContext->height = 64;
+			codecContext->pix_fmt = AV_PIX_FMT_YUV420P;
+			codecContext->time_base = { 1, clipFrameRate };
+			codecContext->framerate = { clipFrameRate, 1 };
+			codecContext->gop_size = gopSize;
+			codecContext->max_b_frames = 0;
+			if (formatContext->oformat->flags & AVFMT_GLOBALHEADER)
+				codecContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+			ASSERT_GE(avcodec_open2(&*codecContext, codec, nullptr), 0);
+
+			auto stream = avformat_new_stream(&*formatContext, nullptr);
+			ASSERT_NE(stream, nullptr);
+			stream->time_base = codecContext->time_base;
+			stream->avg_frame_rate = codecContext->framerate;
+			ASSERT_GE(avcodec_parameters_from_context(stream->codecpar, &*codecContext), 0);
+			ASSERT_GE(avio_open(&formatContext->pb, pathUtf8.c_str(), AVIO_FLAG_WRITE), 0);
+			ASSERT_GE(avformat_write_header(&*formatContext, nullptr), 0);
+
+			AutoReleasePtr<AVFrame, av_frame_free> frame = av_frame_alloc();
+			frame->width = codecContext->width;
+			frame->height = codecContext->height;
+			frame->format = codecContext->pix_fmt;
+			ASSERT_GE(av_frame_get_buffer(&*frame, 0), 0);
+			AutoReleasePtr<AVPacket, av_packet_free> packet = av_packet_alloc();
+
+			auto writePackets = [&]
+				{
+					while (avcodec_receive_packet(&*codecContext, &*packet) >= 0)
+					{
+						av_packet_rescale_ts(&*packet, codecContext->time_base, stream->time_base);
+						packet->stream_index = stream->index;
+						EXPECT_GE(av_interleaved_write_frame(&*formatContext, &*packet), 0);
+					}
+				};
+
+			for (int frameNumber = 0; frameNumber <= frameCount; ++frameNumber)
+			{
+				// the last pass flushes the encoder
+				if (frameNumber < frameCount)
+				{
+					ASSERT_GE(av_frame_make_writable(&*frame), 0);
+					for (int plane = 0; plane < 3; ++plane)
+						for (int y = 0; y < (plane ? frame->height / 2 : frame->height); ++y)
+							memset(frame->data[plane] + y * frame->linesize[plane], plane ? 128 : frameNumber * 2 % 256,
+								plane ? frame->width / 2 : frame->width);
+					frame->pts = frameNumber;
+				}
+				ASSERT_GE(avcodec_send_frame(&*codecContext, frameNumber < frameCount ? &*frame : nullptr), 0);
+				writePackets();
+			}
+
+			ASSERT_GE(av_write_trailer(&*formatContext), 0);
+			ASSERT_GE(avio_closep(&formatContext->pb), 0);
+		}
+	};
+
+	int64_t ToFrameNumber(MediaTime time) { return llround(MediaTimeToSeconds(time) * FFmpegControllerTestAccess::frameRate); }
+
+	struct ExpectedSegment
+	{
+		int64_t startFrameNumber, endFrameNumber, outputFrameOffset;
+		bool streamCopy;
+	};
+
+	void ExpectSegments(const vector<FFmpegControllerExportSegment>& segments, const vector<ExpectedSegment>& expectedSegments)
+	{
+		ASSERT_EQ(segments.size(), expectedSegments.size());
+		for (size_t i = 0; i < segments.size(); ++i)
+		{
+			SCOPED_TRACE(format("segment {}", i));
+			EXPECT_EQ(ToFrameNumber(segments[i].start), expectedSegments[i].startFrameNumber);
+			EXPECT_EQ(ToFrameNumber(segments[i].end), expectedSegments[i].endFrameNumber);
+			EXPECT_EQ(segments[i].outputFrameOffset, expectedSegments[i].outputFrameOffset);
+			EXPECT_EQ(segments[i].frameCount, expectedSegments[i].endFrameNumber - expectedSegments[i].startFrameNumber);
+			EXPECT_EQ(segments[i].streamCopy, expectedSegments[i].streamCopy);
+		}
+	}
+}
+
+TEST(ExportSegments, SplitsLongRangesIntoGopAlignedSegments)
+{
+	FFmpegController controller;
+	FFmpegControllerTestAccess::OpenInput(controller, 6000, 250);
+	controller.SetValidTrimmingRanges({});
+
+	// 4 output GOPs of 600 frames at most
+	ExpectSegments(controller.GetExportSegments(), {
+		{ 0, 2400, 0, false },
+		{ 2400, 4800, 2400, false },
+		{ 4800, 6000, 4800, false } });
+	EXPECT_EQ(controller.GetOutputFrameCount(), 6000);
+}
+
+TEST(ExportSegments, SplitsAtTrimmingRanges)
+{
+	FFmpegController controller;
+	FFmpegControllerTestAccess::OpenInput(controller, 6000, 250);
+	controller.SetValidTrimmingRanges({ { 0, false }, { 1000, true }, { 2000, false } });
+
+	ExpectSegments(controller.GetExportSegments(), {
+		{ 0, 1000, 0, false },
+		{ 2000, 4400, 1000, false },
+		{ 4400, 6000, 3400, false } });
+	EXPECT_EQ(controller.GetOutputFrameCount(), 5000);
+}
+
+TEST(SmartRenderSegments, CopiesWholeGopsAndEncodesTheCuts)
+{
+	FFmpegController controller;
+	FFmpegControllerTestAccess::OpenInput(controller, 6000, 250);
+	controller.SetValidTrimmingRanges({ { 0, true }, { 100, false }, { 1100, true } });
+
+	ExpectSegments(controller.GetSmartRenderSegments(), {
+		{ 100, 250, 0, false },
+		{ 250, 1000, 150, true },
+		{ 1000, 1100, 900, false } });
+}
+
+TEST(SmartRenderSegments, CopiesTheLastGopWhenTheRangeRunsToTheEnd)
+{
+	FFmpegController controller;
+	FFmpegControllerTestAccess::OpenInput(controller, 6000, 250);
+	controller.SetValidTrimmingRanges({ { 0, true }, { 100, false } });
+
+	ExpectSegments(controller.GetSmartRenderSegments(), {
+		{ 100, 250, 0, false },
+		{ 250, 6000, 150, true } });
+}
+
+TEST(SmartRenderSegments, EncodesRangesWithoutAWholeGop)
+{
+	FFmpegController controller;
+	FFmpegControllerTestAccess::OpenInput(controller, 6000, 250);
+	controller.SetValidTrimmingRanges({ { 0, true }, { 260, false }, { 400, true }, { 1000, false }, { 1100, true } });
+
+	ExpectSegments(controller.GetSmartRenderSegments(), {
+		{ 260, 400, 0, false },
+		{ 1000, 1100, 140, false } });
+}
+
+TEST(SegmentDecoding, ScansTheFramesOfContainersWithAnIndex)
+{
+	TestClip clip(100, 10);
+	ASSERT_FALSE(testing::Test::HasFatalFailure());
+
+	// Matroska's cues only list the keyframes, without pts
+	FFmpegController controller;
+	controller.OpenInputVideo(clip.GetPathUtf8().c_str(), false, true);
+	EXPECT_EQ(FFmpegControllerTestAccess::GetIndexedFrameCount(controller), 100u);
+}
+
+TEST(SegmentDecoding, StopsDecodingAfterAMiddleSegment)
+{
+	TestClip clip(100, 10);
+	ASSERT_FALSE(testing::Test::HasFatalFailure());
+
+	FFmpegController controller;
+	controller.OpenInputVideo(clip.GetPathUtf8().c_str(), false);
+	controller.SetValidTrimmingRange(TestClip::GetFramePosition(40), TestClip::GetFramePosition(60));
+
+	// the decoder lands on frame 40 and stops at frame 60, the first one past the segment, instead of reading on to frame 100
+	EXPECT_EQ(FFmpegControllerTestAccess::EnumerateFrames(controller), 20);
+	EXPECT_EQ(FFmpegControllerTestAccess::GetDecodedFrameNumber(controller), 61);
+}
+
+TEST(SegmentDecoding, SegmentsAddUpToTheOutputFrameCount)
+{
+	TestClip clip(100, 10);
+	ASSERT_FALSE(testing::Test::HasFatalFailure());
+
+	FFmpegController controller;
+	controller.OpenInputVideo(clip.GetPathUtf8().c_str(), false, true);
+	controller.SetValidTrimmingRanges({ { 0, false }, { 33, true }, { 51, false } });
+	ASSERT_EQ(controller.GetOutputFrameCount(), 82);
+
+	// every segment on a controller of its own, the way the transcoder's workers decode them
+	auto decodeSegment = [&](MediaTime start, MediaTime end)
+		{
+			FFmpegController segmentController;
+			segmentController.OpenInputVideo(clip.GetPathUtf8().c_str(), false);
+			segmentController.SharePacketIndex(controller);
+			segmentController.SetValidTrimmingRange(start, end);
+			return FFmpegControllerTestAccess::EnumerateFrames(segmentController);
+		};
+
+	int64_t frameCount = 0;
+	for (auto& segment : controller.GetExportSegments())
+	{
+		auto segmentFrameCount = decodeSegment(segment.start, segment.end);
+		EXPECT_EQ(segmentFrameCount, segment.frameCount);
+		frameCount += segmentFrameCount;
+	}
+	EXPECT_EQ(frameCount, controller.GetOutputFrameCount());
+
+	// segment boundaries in the middle of GOPs neither repeat nor drop a frame
+	EXPECT_EQ(decodeSegment(TestClip::GetFramePosition(0), TestClip::GetFramePosition(37)), 37);
+	EXPECT_EQ(decodeSegment(TestClip::GetFramePosition(37), TestClip::GetFramePosition(64)), 27);
+	EXPECT_EQ(decodeSegment(TestClip::GetFramePosition(64), TestClip::GetFramePosition(100)), 36);
+
+	// and every range in one go, the way sequential exports decode
+	EXPECT_EQ(FFmpegControllerTestAccess::EnumerateFrames(controller), controller.GetOutputFrameCount());
+}
@@ -0,0 +1,41 @@
+#include "EngineCommon.h"
+#include "CommandLine.h"
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+TEST(ParseLadder, ParsesHeightsCrfsAndBitrateCaps)
+{
+	auto ladder = ParseLadder("1080,720:23,480:24:1200");
+	ASSERT_EQ(ladder.size(), 3u);
+
+	EXPECT_EQ(ladder[0].height, 1080u);
+	EXPECT_EQ(ladder[0].crf, 0u);
+	EXPECT_EQ(ladder[0].maxBitrateKbps, 0u);
+
+	EXPECT_EQ(ladder[1].height, 720u);
+	EXPECT_EQ(ladder[1].crf, 23u);
+	EXPECT_EQ(ladder[1].maxBitrateKbps, 0u);
+
+	EXPECT_EQ(ladder[2].height, 480u);
+	EXPECT_EQ(ladder[2].crf, 24u);
+	EXPECT_EQ(ladder[2].maxBitrateKbps, 1200u);
+
+	// the widths come from the output size later
+	for (auto& rendition : ladder)
+		EXPECT_EQ(rendition.width, 0u);
+}
+
+TEST(ParseLadder, ParsesSingleRendition)
+{
+	auto ladder = ParseLadder("360");
+	ASSERT_EQ(ladder.size(), 1u);
+	EXPECT_EQ(ladder[0].height, 360u);
+}
+
+TEST(ParseLadder, RejectsInvalidRenditions)
+{
+	for (auto text : { "", "0", "720,", ",720", "720,,480", "720:23:1200:1", "abc", "720:x", "-720", "720p" })
+		EXPECT_THROW(ParseLadder(text), UsageError) << text;
+}
@@ -0,0 +1,168 @@
+#include "EngineCommon.h"
+#include "PacketIndexFile.h"
+
+#include <cstddef>
+#include <fstream>
+#include <gtest/gtest.h>
+
+using namespace std;
+
+namespace
+{
+	// a media file and an index written for it, both removed afterwards
+	class PacketIndexFileTest : public testing::Test
+	{
+	protected:
+		filesystem::path directory, mediaFileName, indexFileName;
+		vector<PacketIndexEntry> entries;
+		vector<uint64_t> keyframePacketIndices;
+
+		void SetUp() override
+		{
+			directory = filesystem::temp_directory_path()
+				/ format("cve-packet-index-test-{}", testing::UnitTest::GetInstance()->current_test_info()->name());
+			filesystem::create_directories(directory);
+			mediaFileName = directory / "media.mp4";
+			indexFileName = directory / "media.mp4.cveindex";
+			ofstream(mediaFileName, ios::binary) << "not really a video";
+
+			for (int64_t i = 0; i < 100; ++i)
+			{
+				if (i % 25 == 0)
+					keyframePacketIndices.push_back(i);
+				entries.push_back({ i * 512 + 1024, i * 512, i * 4096, 4096, i % 25 == 0 });
+			}
+		}
+
+		void TearDown() override
+		{
+			error_code ec;
+			filesystem::remove_all(directory, ec);
+		}
+
+		static PacketIndexFile::Header MakeHeader()
+		{
+			PacketIndexFile::Header header{};
+			header.videoStreamIndex = 1;
+			header.hasBFrames = 2;
+			header.frameRate = { 30000, 1001 };
+			header.guessedFrameRate = { 30000, 1001 };
+			header.pixelFormat = AV_PIX_FMT_YUV420P10LE;
+			header.duration = 3'336'667;
+			return header;
+		}
+
+		bool Write() { return PacketIndexFile::Write(indexFileName, mediaFileName, MakeHeader(), entries, keyframePacketIndices); }
+
+		// overwrites part of the written index in place
+		template<typename T>
+		void Patch(size_t offset, const T& value)
+		{
+			fstream stream(indexFileName, ios::binary | ios::in | ios::out);
+			stream.seekp(offset);
+			stream.write(reinterpret_cast<const char*>(&value), sizeof value);
+		}
+	};
+}
+
+TEST_F(PacketIndexFileTest, RoundTrips)
+{
+	ASSERT_TRUE(Write());
+
+	PacketIndexFile file;
+	ASSERT_TRUE(file.Open(indexFileName, mediaFileName));
+
+	auto& header = file.GetHeader();
+	auto expectedHeader = MakeHeader();
+	EXPECT_EQ(header.videoStreamIndex, expectedHeader.videoStreamIndex);
+	EXPECT_EQ(header.hasBFrames, expectedHeader.hasBFrames);
+	EXPECT_EQ(av_cmp_q(header.frameRate, expectedHeader.frameRate), 0);
+	EXPECT_EQ(av_cmp_q(header.guessedFrameRate, expectedHeader.guessedFrameRate), 0);
+	EXPECT_EQ(header.pixelFormat, expectedHeader.pixelFormat);
+	EXPECT_EQ(header.duration, expectedHeader.duration);
+
+	ASSERT_EQ(file.GetEntries().size(), entries.size());
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		EXPECT_EQ(file.GetEntries()[i].pts, entries[i].pts);
+		EXPECT_EQ(file.GetEntries()[i].dts, entries[i].dts);
+		EXPECT_EQ(file.GetEntries()[i].pos, entries[i].pos);
+		EXPECT_EQ(file.GetEntries()[i].size, entries[i].size);
+		EXPECT_EQ(file.GetEntries()[i].keyframe, entries[i].keyframe);
+	}
+	EXPECT_TRUE(ranges::equal(file.GetKeyframePacketIndices(), keyframePacketIndices));
+}
+
+TEST_F(PacketIndexFileTest, RejectsChangedMediaFile)
+{
+	ASSERT_TRUE(Write());
+	ofstream(mediaFileName, ios::binary | ios::app) << "appended";
+
+	PacketIndexFile file;
+	EXPECT_FALSE(file.Open(indexFileName, mediaFileName));
+	EXPECT_FALSE(file.IsOpen());
+}
+
+TEST_F(PacketIndexFileTest, RejectsMissingFiles)
+{
+	PacketIndexFile file;
+	EXPECT_FALSE(file.Open(indexFileName, mediaFileName));
+
+	ASSERT_TRUE(Write());
+	EXPECT_FALSE(file.Open(indexFileName, directory / "missing.mp4"));
+}
+
+TEST_F(PacketIndexFileTest, RejectsOtherMagicAndVersion)
+{
+	ASSERT_TRUE(Write());
+	Patch(offsetof(PacketIndexFile::Header, magic), uint32_t{ 0x12345678 });
+	PacketIndexFile file;
+	EXPECT_FALSE(file.Open(indexFileName, mediaFileName));
+
+	ASSERT_TRUE(Write());
+	Patch(offsetof(PacketIndexFile::Header, version), uint32_t{ 999 });
+	EXPECT_FALSE(file.Open(indexFileName, mediaFileName));
+}
+
+TEST_F(PacketIndexFileTest, RejectsTruncatedFile)
+{
+	ASSERT_TRUE(Write());
+	filesystem::resize_file(indexFileName, filesystem::file_size(indexFileName) - 1);
+
+	PacketIndexFile file;
+	EXPECT_FALSE(file.Open(indexFileName, mediaFileName));
+
+	filesystem::resize_file(indexFileName, sizeof(PacketIndexFile::Header) - 1);
+	EXPECT_FALSE(file.Open(indexFileName, mediaFileName));
+}
+
+TEST_F(PacketIndexFileTest, RejectsNegativeStreamIndex)
+{
+	ASSERT_TRUE(Write());
+	Patch(offsetof(PacketIndexFile::Header, videoStreamIndex), int32_t{ -1 });
+
+	PacketIndexFile file;
+	EXPECT_FALSE(file.Open(indexFileName, mediaFileName));
+}
+
+TEST_F(PacketIndexFileTest, RejectsOverflowingCounts)
+{
+	// counts whose byte sizes wrap around to the actual file size
+	ASSERT_TRUE(Write());
+	Patch(offsetof(PacketIndexFile::Header, entryCount), uint64_t{ entries.size() } + (uint64_t{ 1 } << 59));
+	PacketIndexFile file;
+	EXPECT_FALSE(file.Open(indexFileName, mediaFileName));
+
+	ASSERT_TRUE(Write());
+	Patch(offsetof(PacketIndexFile::Header, keyframeCount), uint64_t{ keyframePacketIndices.size() } + (uint64_t{ 1 } << 61));
+	EXPECT_FALSE(file.Open(indexFileName, mediaFileName));
+}
+
+TEST_F(PacketIndexFileTest, RejectsKeyframeIndexPastTheEntries)
+{
+	ASSERT_TRUE(Write());
+	Patch(sizeof(PacketIndexFile::Header) + entries.size() * sizeof(PacketIndexEntry) + sizeof(uint64_t), uint64_t{ entries.size() });
+
+	PacketIndexFile file;
+	EXPECT_FALSE(file.Open(indexFileName, mediaFileName));
+}
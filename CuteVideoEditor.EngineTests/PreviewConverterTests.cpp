@@ -0,0 +1,115 @@
+#include "EngineCommon.h"
+#include "PreviewConverter.h"
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+namespace
+{
+	using Kernel = PreviewConverter::Kernel;
+
+	// odd sizes everywhere, so the vector loops always leave a scalar tail
+	constexpr int frameWidth = 333, frameHeight = 187;
+
+	AutoReleasePtr<AVFrame, av_frame_free> MakeFrame(AVPixelFormat format)
+	{
+		AutoReleasePtr<AVFrame, av_frame_free> frame = av_frame_alloc();
+		if (!frame)
+			throw bad_alloc();
+		frame->format = format;
+		frame->width = frameWidth;
+		frame->height = frameHeight;
+		if (av_frame_get_buffer(&*frame, 0) < 0)
+			throw bad_alloc();
+
+		// noise hits every rounding path, 10-bit samples stay in their range
+		uint32_t seed = 1;
+		auto next = [&] { return (seed = seed * 1664525 + 1013904223) >> 16; };
+		auto fill = [&](int plane, int bytes, int height)
+			{
+				for (int y = 0; y < height; ++y)
+				{
+					auto row = frame->data[plane] + static_cast<ptrdiff_t>(y) * frame->linesize[plane];
+					if (format == AV_PIX_FMT_YUV420P10LE)
+						for (int x = 0; x < bytes / 2; ++x)
+							reinterpret_cast<uint16_t*>(row)[x] = static_cast<uint16_t>(next() & 1023);
+					else
+						for (int x = 0; x < bytes; ++x)
+							row[x] = static_cast<uint8_t>(next());
+				}
+			};
+
+		auto sampleBytes = format == AV_PIX_FMT_YUV420P10LE ? 2 : 1;
+		auto chromaWidth = (frameWidth + 1) / 2, chromaHeight = (frameHeight + 1) / 2;
+		fill(0, frameWidth * sampleBytes, frameHeight);
+		if (format == AV_PIX_FMT_NV12)
+			fill(1, chromaWidth * 2, chromaHeight);
+		else
+		{
+			fill(1, chromaWidth * sampleBytes, chromaHeight);
+			fill(2, chromaWidth * sampleBytes, chromaHeight);
+		}
+
+		return frame;
+	}
+
+	vector<uint8_t> Convert(const AVFrame* frame, Kernel kernel, int dstWidth, int dstHeight)
+	{
+		PreviewConverter converter;
+		converter.SetKernel(kernel);
+
+		vector<uint8_t> dst(static_cast<size_t>(dstWidth) * 4 * dstHeight);
+		EXPECT_TRUE(converter.Convert(frame, dst.data(), dstWidth * 4, dstWidth, dstHeight));
+		return dst;
+	}
+}
+
+TEST(PreviewConverter, VectorKernelsMatchScalar)
+{
+	vector<Kernel> kernels;
+	switch (PreviewConverter{}.GetKernel())
+	{
+	case Kernel::Avx2:
+		kernels.push_back(Kernel::Avx2);
+		[[fallthrough]];
+	case Kernel::Sse41:
+		kernels.push_back(Kernel::Sse41);
+		break;
+	default:
+		break;
+	}
+	if (kernels.empty())
+		GTEST_SKIP() << "no vector kernel on this CPU";
+
+	// shrinking by a little, about 2:1 (8 taps), by a lot (more than 8 taps) and enlarging (bilinear)
+	pair<int, int> sizes[] = { { 301, 171 }, { 167, 93 }, { 41, 23 }, { 517, 291 } };
+
+	for (auto pixelFormat : { AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12, AV_PIX_FMT_YUV420P10LE })
+	{
+		auto frame = MakeFrame(pixelFormat);
+		for (auto [dstWidth, dstHeight] : sizes)
+		{
+			auto expected = Convert(&*frame, Kernel::Scalar, dstWidth, dstHeight);
+			for (auto kernel : kernels)
+			{
+				SCOPED_TRACE(format("{} -> {}x{} with kernel {}", av_get_pix_fmt_name(pixelFormat), dstWidth, dstHeight, static_cast<int>(kernel)));
+				EXPECT_EQ(Convert(&*frame, kernel, dstWidth, dstHeight), expected);
+			}
+		}
+	}
+}
+
+TEST(PreviewConverter, LeavesUnsupportedFormatsToTheCaller)
+{
+	AutoReleasePtr<AVFrame, av_frame_free> frame = av_frame_alloc();
+	ASSERT_TRUE(frame);
+	frame->format = AV_PIX_FMT_RGB24;
+	frame->width = frameWidth;
+	frame->height = frameHeight;
+
+	PreviewConverter converter;
+	converter.SetKernel(Kernel::Scalar);
+	uint8_t dst[4]{};
+	EXPECT_FALSE(converter.Convert(&*frame, dst, 4, 1, 1));
+}
@@ -0,0 +1,53 @@
+#include "EngineCommon.h"
+#include "ScalerCache.h"
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+namespace
+{
+	ScalerCache::Key MakeKey(int dstWidth)
+	{
+		return { 1920, 1080, AV_PIX_FMT_YUV420P, dstWidth, dstWidth * 9 / 16, AV_PIX_FMT_BGRA, SWS_BILINEAR };
+	}
+}
+
+TEST(ScalerCache, ReusesScalers)
+{
+	ScalerCache cache(4);
+	auto scaler = cache.Get(MakeKey(640));
+	ASSERT_NE(scaler, nullptr);
+
+	EXPECT_EQ(cache.Get(MakeKey(640)), scaler);
+	EXPECT_EQ(cache.GetHitCount(), 1u);
+	EXPECT_EQ(cache.GetMissCount(), 1u);
+
+	EXPECT_NE(cache.Get(MakeKey(1280)), scaler);
+	EXPECT_EQ(cache.GetMissCount(), 2u);
+}
+
+TEST(ScalerCache, EvictsLeastRecentlyUsed)
+{
+	ScalerCache cache(2);
+	cache.Get(MakeKey(640));
+	cache.Get(MakeKey(1280));
+
+	// 640 is used again, so 1280 goes when 320 comes in
+	cache.Get(MakeKey(640));
+	cache.Get(MakeKey(320));
+	EXPECT_EQ(cache.GetHitCount(), 1u);
+	EXPECT_EQ(cache.GetMissCount(), 3u);
+
+	cache.Get(MakeKey(640));
+	EXPECT_EQ(cache.GetHitCount(), 2u);
+
+	cache.Get(MakeKey(1280));
+	EXPECT_EQ(cache.GetMissCount(), 4u);
+}
+
+TEST(ScalerCache, ThrowsForInvalidParameters)
+{
+	ScalerCache cache(2);
+	EXPECT_THROW(cache.Get({ 0, 0, AV_PIX_FMT_YUV420P, 640, 360, AV_PIX_FMT_BGRA, SWS_BILINEAR }), runtime_error);
+}
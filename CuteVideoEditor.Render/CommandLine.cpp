@@ -0,0 +1,43 @@
+#include "EngineCommon.h"
+#include "CommandLine.h"
+
+using namespace std;
+
+double ParseNumber(const string& name, const string& value)
+{
+	try
+	{
+		size_t end;
+		auto number = stod(value, &end);
+		if (end == value.size() && number >= 0)
+			return number;
+	}
+	catch (const logic_error&) { }
+	throw UsageError(format("Invalid {} '{}'.", name, value));
+}
+
+vector<FFmpegControllerRendition> ParseLadder(const string& text)
+{
+	vector<FFmpegControllerRendition> ladder;
+	for (size_t start = 0; start <= text.size(); )
+	{
+		auto end = min(text.find(',', start), text.size());
+		auto entry = text.substr(start, end - start);
+		start = end + 1;
+
+		uint32_t values[3]{};
+		size_t valueCount = 0;
+		for (size_t valueStart = 0; valueStart <= entry.size(); ++valueCount)
+		{
+			auto valueEnd = min(entry.find(':', valueStart), entry.size());
+			if (valueCount == size(values))
+				throw UsageError(format("Invalid rendition '{}'.", entry));
+			values[valueCount] = static_cast<uint32_t>(ParseNumber("rendition", entry.substr(valueStart, valueEnd - valueStart)));
+			valueStart = valueEnd + 1;
+		}
+		if (!values[0])
+			throw UsageError(format("Invalid rendition '{}'.", entry));
+		ladder.push_back({ 0, values[0], values[1], values[2] });
+	}
+	return ladder;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "FFmpegController.h"
+
+// thrown for bad arguments, which exit with the usage text
+struct UsageError : std::runtime_error
+{
+	using std::runtime_error::runtime_error;
+};
+
+// a non-negative number, the name is for the error message
+double ParseNumber(const std::string& name, const std::string& value);
+
+// --ladder's renditions, heights with optional CRFs and bitrate caps: "1080,720:23,480:24:1200"; the widths are
+// left at 0 for the output size to fill in
+std::vector<FFmpegControllerRendition> ParseLadder(const std::string& text);
@@ -0,0 +1,78 @@
+#include "EngineCommon.h"
+#include "ProjectFile.h"
+
+#include <cctype>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+using namespace std;
+
+// Path.Combine semantics: an absolute media path replaces the project's directory. Projects saved by the editor hold
+// Windows paths, which aren't rooted elsewhere ("C:\clips\a.mp4", "\\server\share\a.mp4"); when the media path
+// doesn't exist here, the media file is looked for next to the project instead.
+static filesystem::path ResolveMediaFileName(const filesystem::path& projectFileName, const string& mediaFileNameUtf8)
+{
+	auto windowsRooted = mediaFileNameUtf8.starts_with("\\\\")
+		|| (mediaFileNameUtf8.size() >= 3 && isalpha(static_cast<unsigned char>(mediaFileNameUtf8[0]))
+			&& mediaFileNameUtf8[1] == ':' && (mediaFileNameUtf8[2] == '\\' || mediaFileNameUtf8[2] == '/'));
+
+	auto mediaFileName = PathFromUtf8(mediaFileNameUtf8);
+	auto resolved = windowsRooted ? mediaFileName : projectFileName.parent_path() / mediaFileName;
+
+	error_code ec;
+	if (filesystem::exists(resolved, ec))
+		return resolved;
+
+	// neither separator is part of a file name on Windows, where the path was written
+	auto nextToProject = projectFileName.parent_path()
+		/ PathFromUtf8(mediaFileNameUtf8.substr(mediaFileNameUtf8.find_last_of("\\/") + 1));
+	return filesystem::exists(nextToProject, ec) ? nextToProject : resolved;
+}
+
+ProjectFile ProjectFile::Load(const filesystem::path& fileName)
+{
+	ifstream stream(fileName);
+	if (!stream)
+		throw runtime_error(format("Could not open the project {}.", PathToUtf8(fileName)));
+
+	ProjectFile project;
+	try
+	{
+		// the same shape System.Text.Json writes for the editor's SerializationModel
+		auto json = nlohmann::json::parse(stream);
+
+		project.mediaFileName = ResolveMediaFileName(fileName, json.at("MediaFileName").get<string>());
+		project.freezeCropSizeMode = json.value("FreezeCropSizeMode", false);
+
+		for (auto& cropFrame : json.at("CropFrames"))
+		{
+			auto& cropRectangle = cropFrame.at("CropRectangle");
+			project.cropFrames.push_back({ cropFrame.at("FrameNumber").get<int64_t>(),
+				{ cropRectangle.at("CenterX").get<int>(), cropRectangle.at("CenterY").get<int>(),
+					cropRectangle.at("Width").get<int>(), cropRectangle.at("Height").get<int>() } });
+		}
+
+		for (auto& trimmingMarker : json.at("TrimmingMarkers"))
+			project.trimmingMarkers.push_back({ trimmingMarker.at("FrameNumber").get<int64_t>(), trimmingMarker.at("TrimAfter").get<bool>() });
+	}
+	catch (const nlohmann::json::exception& e)
+	{
+		throw runtime_error(format("{} is not a valid project: {}", PathToUtf8(fileName), e.what()));
+	}
+
+	if (project.cropFrames.empty())
+		throw runtime_error(format("{} has no crop frames.", PathToUtf8(fileName)));
+
+	return project;
+}
+
+pair<uint32_t, uint32_t> ProjectFile::GetLargestCropSize() const
+{
+	uint32_t width = 0, height = 0;
+	for (auto& cropFrame : cropFrames)
+	{
+		width = max(width, static_cast<uint32_t>(max(cropFrame.cropRectangle.width, 0)));
+		height = max(height, static_cast<uint32_t>(max(cropFrame.cropRectangle.height, 0)));
+	}
+	return { width, height };
+}
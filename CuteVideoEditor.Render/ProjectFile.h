@@ -0,0 +1,19 @@
+#pragma once
+
+#include "FFmpegController.h"
+
+// A .cve project as the editor saves it: the media file, relative to the project or absolute, with its crop
+// frames and trimming markers.
+struct ProjectFile
+{
+	std::filesystem::path mediaFileName;
+	bool freezeCropSizeMode{};
+	std::vector<FFmpegControllerCropFrame> cropFrames;
+	std::vector<FFmpegControllerTrimmingMarker> trimmingMarkers;
+
+	// throws std::runtime_error when the file can't be read or isn't a project
+	static ProjectFile Load(const std::filesystem::path& fileName);
+
+	// the largest crop, which is what the editor exports at unless told to scale
+	std::pair<uint32_t, uint32_t> GetLargestCropSize() const;
+};
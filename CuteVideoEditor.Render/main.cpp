@@ -0,0 +1,321 @@
+#include "EngineCommon.h"
+#include "CommandLine.h"
+#include "ProjectFile.h"
+#include "RenderQueue.h"
+
+#include <cstdio>
+#include <map>
+#include <optional>
+
+using namespace std;
+using namespace chrono;
+
+namespace
+{
+	constexpr const char* usage = R"(Renders a CuteVideoEditor project without the editor.
+
+usage: cve-render [options] <project.cve> [options] -o <output> [options] [-o <output> ...] [<project.cve> ...]
+
+Options before the first project apply to every project, the ones after a project only to it, and the ones after
+an -o only to that output. A project with several outputs decodes once for all of them. Several projects render at
+once, sharing the cores.
+
+  -o, --output <file>        output file, .mp4, .webm, or .mpd for a ladder; repeat it for more outputs of the same project
+  --codec <codec>            h264, hevc, vp8, vp9 or av1; from the extension when left out (.mp4 h264, .webm vp9)
+  --crf <n>                  constant rate factor, 12 when left out
+  --preset <preset>          ultrafast ... placebo, or draft; medium when left out
+  --scale <x>                output size as a multiple of the largest crop, 1 when left out
+  --size <w>x<h>             output size in pixels, instead of --scale
+  --fps-multiplier <x>       playback speed of the output
+  --rate-control <mode>      crf, vbv or two-pass
+  --bitrate <kbps>           bitrate for vbv and two-pass
+  --segment-parallel         encode independent segments in parallel
+  --smart-render             copy untouched source GOPs instead of re-encoding them
+  --scene-detection          place keyframes on scene cuts
+  --ladder <renditions>      an adaptive bitrate ladder into a .mpd output: heights, each optionally with :crf and
+                             :max-kbps, e.g. 1080,720:23,480:24:1200; renditions taller than the output are left out
+  --segment-seconds <s>      ladder segment length, 4 when left out
+  --media <file>             render this media file instead of the one the project names
+  --title <text>             encoder-app metadata
+  --threads <n>              cores shared by all renders, every core when left out
+  --threads-per-job <n>      fewest cores a render runs with, 4 when left out; fewer renders run at once with more
+  --progress-interval <ms>   how often progress is printed, 1000 when left out
+  -q, --quiet                errors only
+  -v, --verbose              FFmpeg's verbose log
+)";
+
+	template<typename T>
+	T ParseEnum(const map<string, T>& values, const string& name, const string& value)
+	{
+		if (auto it = values.find(value); it != values.end())
+			return it->second;
+		throw UsageError(format("Unknown {} '{}'.", name, value));
+	}
+
+	string FormatDuration(MediaTime time)
+	{
+		auto seconds = duration_cast<std::chrono::seconds>(time).count();
+		return format("{:02}:{:02}:{:02}", seconds / 3600, seconds / 60 % 60, seconds % 60);
+	}
+
+	// one output file from the command line, before the project's crop size is known
+	struct OutputOptions
+	{
+		optional<FFmpegControllerOutputType> codec;
+		optional<pair<uint32_t, uint32_t>> size;
+		double scale = 1;
+		TranscoderOutput output;
+
+		// heights, with CRFs and bitrate caps when given; widths follow from the output size
+		vector<FFmpegControllerRendition> ladder;
+	};
+
+	// everything one export needs from the command line, before its project is loaded; options before the first -o
+	// are the template every output starts from
+	struct JobOptions
+	{
+		string projectFileName, mediaFileName;
+		TranscoderInput input;
+		OutputOptions outputTemplate;
+		vector<OutputOptions> outputs;
+	};
+
+	RenderQueueJob LoadJob(JobOptions options)
+	{
+		if (options.outputs.empty())
+			throw UsageError(format("{} needs an output file.", options.projectFileName));
+
+		auto project = ProjectFile::Load(PathFromUtf8(options.projectFileName));
+		auto [cropWidth, cropHeight] = project.GetLargestCropSize();
+
+		RenderQueueJob job{ move(options.input) };
+		for (auto& outputOptions : options.outputs)
+		{
+			auto& output = job.outputs.emplace_back(move(outputOptions.output));
+			if (output.rateControl != FFmpegControllerRateControlMode::Crf && !output.bitrateKbps)
+				throw UsageError("vbv and two-pass rate control need a --bitrate.");
+			if (output.frameRateMultiplier <= 0)
+				throw UsageError("The frame rate multiplier has to be positive.");
+
+			// the same type the editor's export dialog picks for the extension
+			output.type = outputOptions.codec ? *outputOptions.codec
+				: PathFromUtf8(output.fileNameUtf8).extension() == ".webm" ? FFmpegControllerOutputType::Vp9 : FFmpegControllerOutputType::Mp4;
+
+			// 4:2:0 output needs even dimensions
+			auto [width, height] = outputOptions.size ? *outputOptions.size
+				: pair{ static_cast<uint32_t>(cropWidth * outputOptions.scale), static_cast<uint32_t>(cropHeight * outputOptions.scale) };
+			output.width = max(2u, width & ~1u);
+			output.height = max(2u, height & ~1u);
+
+			if (!outputOptions.ladder.empty() && PathFromUtf8(output.fileNameUtf8).extension() != ".mpd")
+				throw UsageError(format("A ladder is written behind a DASH manifest, {} needs to be a .mpd file.", output.fileNameUtf8));
+
+			// renditions keep the output's aspect ratio, and never go above its size
+			for (auto rendition : outputOptions.ladder)
+			{
+				if (rendition.height > output.height)
+					continue;
+				rendition.width = max(2u, static_cast<uint32_t>(llround(static_cast<double>(output.width) * rendition.height / output.height)) & ~1u);
+				rendition.height = max(2u, rendition.height & ~1u);
+				if (!rendition.crf)
+					rendition.crf = output.crf;
+				output.renditions.push_back(rendition);
+			}
+			if (!outputOptions.ladder.empty() && output.renditions.empty())
+				throw UsageError(format("Every rendition of {} is taller than its {}x{} output.", output.fileNameUtf8, output.width, output.height));
+		}
+
+		job.input.fileNameUtf8 = options.mediaFileName.empty() ? PathToUtf8(project.mediaFileName) : options.mediaFileName;
+		job.input.cropFrames = move(project.cropFrames);
+		job.input.trimmingMarkers = move(project.trimmingMarkers);
+		return job;
+	}
+
+	int Run(int argc, char** argv)
+	{
+		const map<string, FFmpegControllerOutputType> codecs =
+		{
+			{ "h264", FFmpegControllerOutputType::Mp4 }, { "hevc", FFmpegControllerOutputType::Mp4Hevc },
+			{ "vp8", FFmpegControllerOutputType::Vp8 }, { "vp9", FFmpegControllerOutputType::Vp9 }, { "av1", FFmpegControllerOutputType::Av1 },
+		};
+		const map<string, FFmpegControllerPresetType> presets =
+		{
+			{ "ultrafast", FFmpegControllerPresetType::UltraFast }, { "superfast", FFmpegControllerPresetType::SuperFast },
+			{ "veryfast", FFmpegControllerPresetType::VeryFast }, { "faster", FFmpegControllerPresetType::Faster },
+			{ "fast", FFmpegControllerPresetType::Fast }, { "medium", FFmpegControllerPresetType::Medium },
+			{ "slow", FFmpegControllerPresetType::Slow }, { "slower", FFmpegControllerPresetType::Slower },
+			{ "veryslow", FFmpegControllerPresetType::VerySlow }, { "placebo", FFmpegControllerPresetType::Placebo },
+			{ "draft", FFmpegControllerPresetType::Draft },
+		};
+		const map<string, FFmpegControllerRateControlMode> rateControlModes =
+		{
+			{ "crf", FFmpegControllerRateControlMode::Crf }, { "vbv", FFmpegControllerRateControlMode::Vbv },
+			{ "two-pass", FFmpegControllerRateControlMode::TwoPass },
+		};
+
+		// options before the first project are every job's defaults, the ones after a project are only its own
+		JobOptions defaults;
+		defaults.input.encoderTitleUtf8 = "CuteVideoEditor cve-render";
+		defaults.outputTemplate.output.crf = 12;
+		vector<JobOptions> jobOptions;
+		auto currentJob = [&]() -> JobOptions& { return jobOptions.empty() ? defaults : jobOptions.back(); };
+		auto current = [&]() -> OutputOptions&
+			{
+				auto& job = currentJob();
+				return job.outputs.empty() ? job.outputTemplate : job.outputs.back();
+			};
+
+		RenderQueue renderQueue;
+		auto progressInterval = milliseconds(1000);
+
+		for (int i = 1; i < argc; ++i)
+		{
+			string argument = argv[i];
+			auto value = [&]() -> string
+				{
+					if (i + 1 >= argc)
+						throw UsageError(format("{} needs a value.", argument));
+					return argv[++i];
+				};
+
+			if (argument == "-h" || argument == "--help")
+			{
+				fputs(usage, stdout);
+				return 0;
+			}
+			else if (argument == "-o" || argument == "--output")
+			{
+				auto& job = currentJob();
+				job.outputs.push_back(job.outputTemplate);
+				job.outputs.back().output.fileNameUtf8 = value();
+			}
+			else if (argument == "--codec")
+				current().codec = ParseEnum(codecs, "codec", value());
+			else if (argument == "--crf")
+				current().output.crf = static_cast<uint32_t>(ParseNumber("crf", value()));
+			else if (argument == "--preset")
+				current().output.preset = ParseEnum(presets, "preset", value());
+			else if (argument == "--scale")
+				current().scale = ParseNumber("scale", value());
+			else if (argument == "--size")
+			{
+				auto text = value();
+				auto separator = text.find('x');
+				if (separator == string::npos)
+					throw UsageError(format("Invalid size '{}'.", text));
+				current().size = { static_cast<uint32_t>(ParseNumber("width", text.substr(0, separator))),
+					static_cast<uint32_t>(ParseNumber("height", text.substr(separator + 1))) };
+			}
+			else if (argument == "--fps-multiplier")
+				current().output.frameRateMultiplier = ParseNumber("frame rate multiplier", value());
+			else if (argument == "--rate-control")
+				current().output.rateControl = ParseEnum(rateControlModes, "rate control", value());
+			else if (argument == "--bitrate")
+				current().output.bitrateKbps = static_cast<uint32_t>(ParseNumber("bitrate", value()));
+			else if (argument == "--segment-parallel")
+				current().output.segmentParallel = true;
+			else if (argument == "--smart-render")
+				current().output.smartRender = true;
+			else if (argument == "--scene-detection")
+				current().output.sceneDetection = true;
+			else if (argument == "--ladder")
+				current().ladder = ParseLadder(value());
+			else if (argument == "--segment-seconds")
+			{
+				auto seconds = ParseNumber("segment length", value());
+				if (seconds <= 0)
+					throw UsageError("The segment length has to be positive.");
+				current().output.segmentDuration = MediaTimeFromSeconds(seconds);
+			}
+			else if (argument == "--media")
+				currentJob().mediaFileName = value();
+			else if (argument == "--title")
+				currentJob().input.encoderTitleUtf8 = value();
+			else if (argument == "--threads")
+				renderQueue.SetThreadBudget(static_cast<uint32_t>(ParseNumber("thread count", value())));
+			else if (argument == "--threads-per-job")
+				renderQueue.SetThreadsPerJob(static_cast<uint32_t>(ParseNumber("thread count", value())));
+			else if (argument == "--progress-interval")
+				progressInterval = milliseconds(static_cast<int64_t>(ParseNumber("progress interval", value())));
+			else if (argument == "-q" || argument == "--quiet")
+				av_log_set_level(AV_LOG_ERROR);
+			else if (argument == "-v" || argument == "--verbose")
+				av_log_set_level(AV_LOG_VERBOSE);
+			else if (argument.starts_with("-"))
+				throw UsageError(format("Unexpected argument '{}'.", argument));
+			else
+			{
+				jobOptions.push_back(defaults);
+				jobOptions.back().projectFileName = argument;
+			}
+		}
+
+		if (jobOptions.empty())
+			throw UsageError("A project and an output file are required.");
+
+		// every project loads before the first render starts, so a typo doesn't surface hours into a batch
+		vector<string> outputFileNamesUtf8, projectFileNamesUtf8;
+		for (auto& options : jobOptions)
+		{
+			for (auto& outputOptions : options.outputs)
+			{
+				if (ranges::count(outputFileNamesUtf8, outputOptions.output.fileNameUtf8))
+					throw UsageError(format("More than one output renders to {}.", outputOptions.output.fileNameUtf8));
+				outputFileNamesUtf8.push_back(outputOptions.output.fileNameUtf8);
+			}
+			projectFileNamesUtf8.push_back(options.projectFileName);
+			renderQueue.AddJob(LoadJob(move(options)));
+		}
+
+		// one line per report, render farm logs don't handle carriage returns; a batch prefixes every line with its job
+		auto jobCount = renderQueue.GetJobCount();
+		auto jobPrefix = [&](size_t jobIndex) { return jobCount > 1 ? format("[{}/{}] ", jobIndex + 1, jobCount) : string(); };
+
+		renderQueue.SetProgressInterval(progressInterval);
+		renderQueue.SetJobProgressCallback([&](size_t jobIndex, const TranscoderProgress& progress)
+			{
+				if (progress.analyzingScenes)
+				{
+					fprintf(stderr, "%sanalyzing scenes, frame %lld/%lld (%.1f%%), %.1f fps, elapsed %s\n", jobPrefix(jobIndex).c_str(),
+						static_cast<long long>(progress.decodedFrameCount), static_cast<long long>(progress.totalFrameCount),
+						progress.totalFrameCount ? 100.0 * progress.decodedFrameCount / progress.totalFrameCount : 0.0,
+						progress.decodeFps, FormatDuration(progress.elapsed).c_str());
+					return;
+				}
+
+				fprintf(stderr, "%sframe %lld/%lld (%.1f%%), %.1f fps, %.1f MiB, elapsed %s, eta %s\n", jobPrefix(jobIndex).c_str(),
+					static_cast<long long>(progress.encodedFrameCount), static_cast<long long>(progress.totalFrameCount),
+					progress.totalFrameCount ? 100.0 * progress.encodedFrameCount / progress.totalFrameCount : 0.0,
+					progress.encodeFps, progress.bytesWritten / 1048576.0,
+					FormatDuration(progress.elapsed).c_str(), FormatDuration(progress.eta).c_str());
+			});
+		renderQueue.SetJobStateCallback([&](size_t jobIndex, RenderQueueJobState state, const string& error)
+			{
+				if (state == RenderQueueJobState::Failed)
+					fprintf(stderr, "%sRendering %s failed: %s\n", jobPrefix(jobIndex).c_str(), projectFileNamesUtf8[jobIndex].c_str(), error.c_str());
+				else if (jobCount > 1)
+					fprintf(stderr, "%s%s %s\n", jobPrefix(jobIndex).c_str(), state == RenderQueueJobState::Running ? "Rendering" : "Finished",
+						projectFileNamesUtf8[jobIndex].c_str());
+			});
+
+		return renderQueue.Run() ? 1 : 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Run(argc, argv);
+	}
+	catch (const UsageError& e)
+	{
+		fprintf(stderr, "%s\n\n%s", e.what(), usage);
+		return 2;
+	}
+	catch (const exception& e)
+	{
+		fprintf(stderr, "Rendering failed: %s\n", e.what());
+		return 1;
+	}
+}
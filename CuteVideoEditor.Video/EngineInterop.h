@@ -0,0 +1,41 @@
+#pragma once
+
+#include "FFmpegController.h"
+#include <winrt/CuteVideoEditor_Video.h>
+
+// conversions between the WinRT runtimeclasses and the engine's plain types
+
+std::vector<FFmpegControllerCropFrame> inline ToEngineCropFrames(
+	winrt::Windows::Foundation::Collections::IVectorView<winrt::CuteVideoEditor_Video::TranscodeInputCropFrameEntry> const& cropFrames)
+{
+	std::vector<FFmpegControllerCropFrame> output;
+	if (cropFrames)
+		for (auto cropFrame : cropFrames)
+		{
+			auto cropRectangle = cropFrame.CropRectangle();
+			output.push_back({ cropFrame.FrameNumber(),
+				{ cropRectangle.CenterX(), cropRectangle.CenterY(), cropRectangle.Width(), cropRectangle.Height() } });
+		}
+	return output;
+}
+
+std::vector<FFmpegControllerTrimmingMarker> inline ToEngineTrimmingMarkers(
+	winrt::Windows::Foundation::Collections::IVectorView<winrt::CuteVideoEditor_Video::TranscodeInputTrimmingMarkerEntry> const& trimmingMarkers)
+{
+	std::vector<FFmpegControllerTrimmingMarker> output;
+	if (trimmingMarkers)
+		for (auto trimmingMarker : trimmingMarkers)
+			output.push_back({ trimmingMarker.FrameNumber(), trimmingMarker.TrimAfter() });
+	return output;
+}
+
+// scales straight into the locked bitmap memory, using its own layout instead of assuming a packed image
+void inline ConvertFrameToBitmap(FFmpegController& controller, AVFrame* frame, winrt::Windows::Graphics::Imaging::SoftwareBitmap const& bitmap)
+{
+	auto bitmapBuffer = bitmap.LockBuffer(winrt::Windows::Graphics::Imaging::BitmapBufferAccessMode::Write);
+	auto planeDescription = bitmapBuffer.GetPlaneDescription(0);
+	auto bitmapBufferReference = bitmapBuffer.CreateReference();
+
+	controller.ConvertFrameToBgra(frame, bitmapBufferReference.data() + planeDescription.StartIndex, planeDescription.Stride,
+		planeDescription.Width, planeDescription.Height);
+}
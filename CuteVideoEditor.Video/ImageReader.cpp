@@ -1,5 +1,6 @@
 ﻿#include "pch.h"
 #include "ImageReader.h"
+#include "EngineInterop.h"
 
 #include "ImageReader.g.cpp"
 
@@ -10,10 +11,12 @@ using namespace Windows::Graphics::Imaging;
 
 namespace winrt::CuteVideoEditor_Video::implementation
 {
-	ImageReader::ImageReader(hstring const& fileName)
+	ImageReader::ImageReader(hstring const& fileName, hstring const& packetIndexFileName)
 		: ffmpegController(make_unique<FFmpegController>())
 	{
-		ffmpegController->OpenInputVideo(StringUtils::PlatformStringToUtf8String(fileName).c_str(), false);
+		auto packetIndexFileNameUtf8 = StringUtils::PlatformStringToUtf8String(packetIndexFileName);
+		ffmpegController->OpenInputVideo(StringUtils::PlatformStringToUtf8String(fileName).c_str(), false, true,
+			packetIndexFileName.empty() ? nullptr : packetIndexFileNameUtf8.c_str());
 		frameRate = ffmpegController->GetFrameRate();
 		mediaDuration = ffmpegController->GetMediaDuration();
 
@@ -24,12 +27,13 @@ namespace winrt::CuteVideoEditor_Video::implementation
 
 	void ImageReader::Close()
 	{
+		frameCache.Clear();
 		ffmpegController.reset();
 	}
 
 	void ImageReader::SetTrimmingMarkers(IVectorView<CuteVideoEditor_Video::TranscodeInputTrimmingMarkerEntry> trimmingMarkers)
 	{
-		ffmpegController->SetValidTrimmingRanges(to_vector(trimmingMarkers));
+		ffmpegController->SetValidTrimmingRanges(ToEngineTrimmingMarkers(trimmingMarkers));
 	}
 
 	void ImageReader::InitializeFrameEnumerator()
@@ -47,24 +51,74 @@ namespace winrt::CuteVideoEditor_Video::implementation
 			if (ffmpegFrameIterator == ffmpegFrameGenerator.end())
 				return false;
 
-			// read the video stream geometry and create the bitmap
+			// read the video stream geometry, the bitmap itself is sized when displaying the frame
 			auto frame = *ffmpegFrameIterator;
-			currentFrameBitmap = { BitmapPixelFormat::Rgba8, frame->width, frame->height };
+			pixelWidth = frame->width;
+			pixelHeight = frame->height;
 		}
 
 		if (!*ffmpegFrameIterator)
 			return false;
 
-		auto rgbaFrame = ffmpegController->GetRgbaTemporaryFrame(*ffmpegFrameIterator);
+		frameCache.Add(*ffmpegFrameIterator);
+		decodedPosition = ffmpegController->GetFramePosition(*ffmpegFrameIterator);
+		DisplayFrame(*ffmpegFrameIterator);
 
-		auto pixelBuffer = currentFrameBitmap.LockBuffer(BitmapBufferAccessMode::Write);
-		auto buffer = pixelBuffer.CreateReference().data();
-		memcpy(buffer, rgbaFrame->data[0], rgbaFrame->linesize[0] * rgbaFrame->height);
+		return true;
+	}
 
-		ffmpegController->ReleaseTemporaryFrame(rgbaFrame);
-		frameDuration = ffmpegController->GetFrameDuration(*ffmpegFrameIterator);
+	void ImageReader::DisplayFrame(AVFrame* frame)
+	{
+		auto [width, height] = fullResolution ? pair{ frame->width, frame->height }
+			: ffmpegController->GetPreviewSize(frame, previewMaxWidth, previewMaxHeight);
+		if (!currentFrameBitmap || currentFrameBitmap.PixelWidth() != width || currentFrameBitmap.PixelHeight() != height)
+			currentFrameBitmap = { BitmapPixelFormat::Rgba8, width, height };
 
-		return true;
+		ConvertFrameToBitmap(*ffmpegController, frame, currentFrameBitmap);
+		frameDuration = ffmpegController->GetFrameDuration(frame);
+	}
+
+	void ImageReader::RedisplayCurrentFrame()
+	{
+		// the displayed frame always went through the cache, so it can be converted again at the new size
+		if (auto cachedFrame = frameCache.Find(ffmpegController->GetPtsFromPosition(position),
+			ffmpegController->GetPtsFromPosition(TimeSpanFromSeconds(0.5 / frameRate))))
+		{
+			DisplayFrame(cachedFrame);
+		}
+	}
+
+	void ImageReader::SetPreviewSize(int32_t maxWidth, int32_t maxHeight)
+	{
+		if (maxWidth == previewMaxWidth && maxHeight == previewMaxHeight) return;
+
+		previewMaxWidth = maxWidth;
+		previewMaxHeight = maxHeight;
+		if (!fullResolution)
+			RedisplayCurrentFrame();
+	}
+
+	void ImageReader::FullResolution(bool value)
+	{
+		if (value == fullResolution) return;
+
+		fullResolution = value;
+		RedisplayCurrentFrame();
+	}
+
+	void ImageReader::Scrubbing(bool value)
+	{
+		if (value == scrubbing) return;
+
+		scrubbing = value;
+		ffmpegController->SetSkipLoopFilter(value);
+
+		// frames decoded while scrubbing are missing their deblocking, decode the one we stopped on again
+		if (!scrubbing)
+		{
+			frameCache.Clear();
+			SeekAndDisplay();
+		}
 	}
 
 	bool ImageReader::AdvanceFrame()
@@ -78,17 +132,34 @@ namespace winrt::CuteVideoEditor_Video::implementation
 
 	void ImageReader::Position(Windows::Foundation::TimeSpan const value)
 	{
-		// only start a seek if we're going backwards, or far enough forward
 		if (value == position) return;
-		if (value >= position && value - position <= chrono::seconds(1))
+
+		// recently decoded frames, which covers stepping backwards inside the current GOP
+		if (auto cachedFrame = frameCache.Find(ffmpegController->GetPtsFromPosition(value),
+			ffmpegController->GetPtsFromPosition(TimeSpanFromSeconds(0.5 / frameRate))))
 		{
+			position = value;
+			DisplayFrame(cachedFrame);
+			return;
+		}
+
+		// only start a seek if we're going backwards, or far enough forward
+		if (value >= decodedPosition && value - decodedPosition <= chrono::seconds(1))
+		{
+			position = decodedPosition;
 			while (TimeSpanToSeconds(value - position) >= 0.99 / frameRate)
 				if (!AdvanceFrame())
 					break;
 			return;
 		}
 
-		ffmpegController->Seek(position = value);
+		position = value;
+		SeekAndDisplay();
+	}
+
+	void ImageReader::SeekAndDisplay()
+	{
+		ffmpegController->SeekToFrame(ffmpegController->GetInputFrameNumber(position), [&](AVFrame* frame) { frameCache.Add(frame); });
 		InitializeFrameEnumerator();
 		ReadCurrentFrame(false);
 	}
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
-#include <FFmpegController.h>
+#include "FFmpegController.h"
+#include "DecodedFrameCache.h"
 
 #include "ImageReader.g.h"
 
@@ -8,12 +9,14 @@ namespace winrt::CuteVideoEditor_Video::implementation
 {
 	struct ImageReader : ImageReaderT<ImageReader>
 	{
-		ImageReader(hstring const& fileName);
+		ImageReader(hstring const& fileName) : ImageReader(fileName, {}) { }
+		ImageReader(hstring const& fileName, hstring const& packetIndexFileName);
 		~ImageReader() { Close(); }
 		void Close();
 
 		void SetTrimmingMarkers(Windows::Foundation::Collections::IVectorView<CuteVideoEditor_Video::TranscodeInputTrimmingMarkerEntry> trimmingMarkers);
 		bool AdvanceFrame();
+		void SetPreviewSize(int32_t maxWidth, int32_t maxHeight);
 
 		hstring FileName() const { return fileName; }
 		int32_t VideoStreamIndex() const { return videoStreamIndex; }
@@ -22,20 +25,40 @@ namespace winrt::CuteVideoEditor_Video::implementation
 		Windows::Foundation::TimeSpan Position() const { return position; }
 		void Position(Windows::Foundation::TimeSpan const value);
 		Windows::Foundation::TimeSpan FrameDuration() const { return frameDuration; }
+		int32_t PixelWidth() const { return pixelWidth; }
+		int32_t PixelHeight() const { return pixelHeight; }
 		Windows::Graphics::Imaging::SoftwareBitmap CurrentFrameBitmap() const { return currentFrameBitmap; }
+		bool FullResolution() const { return fullResolution; }
+		void FullResolution(bool value);
+		bool Scrubbing() const { return scrubbing; }
+		void Scrubbing(bool value);
+		uint64_t FrameCacheByteBudget() const { return frameCache.GetByteBudget(); }
+		void FrameCacheByteBudget(uint64_t value) { frameCache.SetByteBudget(value); }
 
 	private:
 		void InitializeFrameEnumerator();
 		bool ReadCurrentFrame(bool initialize);
+		void DisplayFrame(AVFrame* frame);
+		void RedisplayCurrentFrame();
+		void SeekAndDisplay();
 
 		std::unique_ptr<FFmpegController> ffmpegController;
 		asyncpp::generator<AVFrame*> ffmpegFrameGenerator;
 		asyncpp::generator<AVFrame*>::iterator ffmpegFrameIterator;
 		Windows::Graphics::Imaging::SoftwareBitmap currentFrameBitmap{ nullptr };
+		DecodedFrameCache frameCache{ 512 * 1024 * 1024 };
 
 		hstring fileName;
 		int32_t videoStreamIndex{};
+		int32_t pixelWidth{}, pixelHeight{};
+
+		// the bitmap is only as large as the player needs, unless full resolution is requested
+		int32_t previewMaxWidth{}, previewMaxHeight{};
+		bool fullResolution{}, scrubbing{};
 		Windows::Foundation::TimeSpan mediaDuration{}, position{}, frameDuration{};
+
+		// position of the frame the decoder is currently at, which trails or leads position after cache hits
+		Windows::Foundation::TimeSpan decodedPosition{};
 		double frameRate{};
 	};
 }
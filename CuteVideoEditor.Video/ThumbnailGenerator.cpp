@@ -0,0 +1,81 @@
+#include "pch.h"
+#include "ThumbnailGenerator.h"
+#include "EngineInterop.h"
+
+#include "ThumbnailGeneratedEventArgs.g.cpp"
+#include "ThumbnailGenerator.g.cpp"
+
+using namespace std;
+using namespace winrt;
+using namespace Windows::Foundation;
+using namespace Windows::Graphics::Imaging;
+
+namespace winrt::CuteVideoEditor_Video::implementation
+{
+	ThumbnailGenerator::ThumbnailGenerator(hstring const& fileName)
+		: fileNameUtf8(StringUtils::PlatformStringToUtf8String(fileName))
+	{
+	}
+
+	IAsyncAction ThumbnailGenerator::GenerateAsync(int32_t count, int32_t maxWidth, int32_t maxHeight)
+	{
+		auto strongThis = get_strong();
+		auto cancellation = co_await get_cancellation_token();
+		co_await resume_background();
+
+		if (count <= 0)
+			co_return;
+
+		// every worker needs its own demuxer and decoder, so don't start more than there are thumbnails
+		auto workerCount = clamp<int32_t>(max(1u, thread::hardware_concurrency() / 2), 1, count);
+
+		atomic<int32_t> nextIndex{};
+		exception_ptr workerException;
+		mutex workerExceptionMutex;
+
+		{
+			vector<jthread> workers;
+			for (int32_t workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+				workers.emplace_back([&]
+					{
+						try
+						{
+							FFmpegController controller;
+							controller.OpenInputVideo(fileNameUtf8.c_str(), false);
+							controller.SetSkipNonKeyframes(true);
+
+							auto mediaDuration = controller.GetMediaDuration();
+							for (int32_t index; !closed && !cancellation() && (index = nextIndex++) < count; )
+							{
+								// evenly spaced, each in the middle of its slot
+								auto position = TimeSpan{ static_cast<int64_t>((index + 0.5) * mediaDuration.count() / count) };
+
+								controller.DecodeKeyframe(position, [&](AVFrame* frame)
+									{
+										auto [width, height] = controller.GetPreviewSize(frame, maxWidth, maxHeight);
+										SoftwareBitmap bitmap{ BitmapPixelFormat::Bgra8, width, height };
+										ConvertFrameToBitmap(controller, frame, bitmap);
+
+										thumbnailGenerated(*this, make<ThumbnailGeneratedEventArgs>(index, controller.GetFramePosition(frame), bitmap));
+									});
+							}
+						}
+						catch (...)
+						{
+							lock_guard lock(workerExceptionMutex);
+							if (!workerException)
+								workerException = current_exception();
+						}
+					});
+		}
+
+		if (workerException)
+			rethrow_exception(workerException);
+	}
+
+	void ThumbnailGenerator::Close()
+	{
+		// running workers stop before their next thumbnail
+		closed = true;
+	}
+}
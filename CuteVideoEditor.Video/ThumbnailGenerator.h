@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ThumbnailGeneratedEventArgs.g.h"
+#include "ThumbnailGenerator.g.h"
+
+namespace winrt::CuteVideoEditor_Video::implementation
+{
+	struct ThumbnailGeneratedEventArgs : ThumbnailGeneratedEventArgsT<ThumbnailGeneratedEventArgs>
+	{
+		int32_t Index() const { return index; }
+		Windows::Foundation::TimeSpan Position() const { return position; }
+		Windows::Graphics::Imaging::SoftwareBitmap Bitmap() const { return bitmap; }
+
+		ThumbnailGeneratedEventArgs(int32_t index, Windows::Foundation::TimeSpan position, Windows::Graphics::Imaging::SoftwareBitmap const& bitmap)
+			: index(index), position(position), bitmap(bitmap)
+		{
+		}
+
+	private:
+		int32_t index{};
+		Windows::Foundation::TimeSpan position{};
+		Windows::Graphics::Imaging::SoftwareBitmap bitmap{ nullptr };
+	};
+
+	struct ThumbnailGenerator : ThumbnailGeneratorT<ThumbnailGenerator>
+	{
+		ThumbnailGenerator(hstring const& fileName);
+
+		Windows::Foundation::IAsyncAction GenerateAsync(int32_t count, int32_t maxWidth, int32_t maxHeight);
+
+		winrt::event_token ThumbnailGenerated(Windows::Foundation::EventHandler<CuteVideoEditor_Video::ThumbnailGeneratedEventArgs> const& handler) { return thumbnailGenerated.add(handler); }
+		void ThumbnailGenerated(winrt::event_token const& token) noexcept { thumbnailGenerated.remove(token); }
+
+		~ThumbnailGenerator() { Close(); }
+		void Close();
+
+	private:
+		std::string fileNameUtf8;
+		std::atomic<bool> closed{};
+		winrt::event<Windows::Foundation::EventHandler<CuteVideoEditor_Video::ThumbnailGeneratedEventArgs>> thumbnailGenerated;
+	};
+}
+
+namespace winrt::CuteVideoEditor_Video::factory_implementation
+{
+	struct ThumbnailGeneratedEventArgs : ThumbnailGeneratedEventArgsT<ThumbnailGeneratedEventArgs, implementation::ThumbnailGeneratedEventArgs>
+	{
+	};
+
+	struct ThumbnailGenerator : ThumbnailGeneratorT<ThumbnailGenerator, implementation::ThumbnailGenerator>
+	{
+	};
+}
@@ -1,63 +1,118 @@
 ﻿#include "pch.h"
 #include "Transcode.h"
-#include "FFmpegController.h"
+#include "Transcoder.h"
+#include "EngineInterop.h"
 
 #include "TranscodeInput.g.cpp"
 #include "TranscodeInputCropFrameEntry.g.cpp"
 #include "TranscodeInputCropRectangle.g.cpp"
 #include "TranscodeInputTrimmingMarkerEntry.g.cpp"
+#include "TranscodeRendition.g.cpp"
 #include "TranscodeOutput.g.cpp"
 #include "TranscodeFrameOutputProgressEventArgs.g.cpp"
+#include "TranscodeProgressEventArgs.g.cpp"
 #include "Transcode.g.cpp"
 
 using namespace std;
+using namespace chrono;
 using namespace winrt;
 using namespace Windows::Graphics::Imaging;
 
 namespace winrt::CuteVideoEditor_Video::implementation
 {
 	Transcode::Transcode()
-		: ffmpegController(make_unique<FFmpegController>())
+		: transcoder(make_unique<Transcoder>())
 	{
 	}
 
+	static TranscoderOutput ToTranscoderOutput(CuteVideoEditor_Video::TranscodeOutput const& output)
+	{
+		TranscoderOutput transcoderOutput;
+		transcoderOutput.fileNameUtf8 = StringUtils::PlatformStringToUtf8String(output.FileName());
+		transcoderOutput.type = static_cast<FFmpegControllerOutputType>(output.Type());
+		transcoderOutput.crf = output.CRF();
+		transcoderOutput.preset = static_cast<FFmpegControllerPresetType>(output.Preset());
+		transcoderOutput.width = static_cast<uint32_t>(output.PixelSize().Width);
+		transcoderOutput.height = static_cast<uint32_t>(output.PixelSize().Height);
+		transcoderOutput.frameRateMultiplier = output.FrameRateMultiplier();
+		transcoderOutput.segmentParallel = output.SegmentParallel();
+		transcoderOutput.smartRender = output.SmartRender();
+		transcoderOutput.rateControl = static_cast<FFmpegControllerRateControlMode>(output.RateControl());
+		transcoderOutput.bitrateKbps = output.BitrateKbps();
+		transcoderOutput.sceneDetection = output.SceneDetection();
+
+		if (auto renditions = output.Renditions())
+			for (auto rendition : renditions)
+				transcoderOutput.renditions.push_back({ static_cast<uint32_t>(rendition.PixelSize().Width),
+					static_cast<uint32_t>(rendition.PixelSize().Height), rendition.CRF(), rendition.MaxBitrateKbps() });
+		transcoderOutput.segmentDuration = output.SegmentDuration();
+		return transcoderOutput;
+	}
+
 	void Transcode::Run(CuteVideoEditor_Video::TranscodeInput const& input, CuteVideoEditor_Video::TranscodeOutput const& output)
 	{
-		if (!ffmpegController)
+		RunOutputs(input, single_threaded_vector<CuteVideoEditor_Video::TranscodeOutput>({ output }).GetView());
+	}
+
+	void Transcode::RunOutputs(CuteVideoEditor_Video::TranscodeInput const& input,
+		Windows::Foundation::Collections::IVectorView<CuteVideoEditor_Video::TranscodeOutput> const& outputs)
+	{
+		if (!transcoder)
 			throw_hresult(RO_E_CLOSED);
 
-		ffmpegController->OpenInputVideo(StringUtils::PlatformStringToUtf8String(input.FileName()).c_str(), true);
-		ffmpegController->SetValidTrimmingRanges(to_vector(input.TrimmingMarkers()));
+		TranscoderInput transcoderInput;
+		transcoderInput.fileNameUtf8 = StringUtils::PlatformStringToUtf8String(input.FileName());
+		transcoderInput.cropFrames = ToEngineCropFrames(input.CropFrames());
+		transcoderInput.trimmingMarkers = ToEngineTrimmingMarkers(input.TrimmingMarkers());
+		transcoderInput.encoderTitleUtf8 = StringUtils::PlatformStringToUtf8String(input.EncoderTitle());
 
-		ffmpegController->OpenOutputVideo(StringUtils::PlatformStringToUtf8String(output.FileName()).c_str(),
-			output.Type(), output.CRF(), static_cast<uint32_t>(output.PixelSize().Width), static_cast<uint32_t>(output.PixelSize().Height),
-			StringUtils::PlatformStringToUtf8String(input.EncoderTitle()).c_str(),
-			to_vector(input.CropFrames()), true);
+		vector<TranscoderOutput> transcoderOutputs;
+		for (auto output : outputs)
+			transcoderOutputs.push_back(ToTranscoderOutput(output));
 
-		uint64_t encodedFrameIndex = 0;
-		const uint64_t frameOutputProgressInterval = 60;
-		for (auto frame : ffmpegController->EnumerateInputFrames())
-		{
-			if (encodedFrameIndex++ % frameOutputProgressInterval == 0)
+		transcoder->SetProgressInterval(progressInterval);
+		transcoder->SetProgressCallback([&](const TranscoderProgress& transcoderProgress)
 			{
-				auto frameBitmap = ffmpegController->GetRgbaTemporaryFrame(frame, 600, 600);
+				auto args = make_self<TranscodeProgressEventArgs>();
+				args->analyzingScenes = transcoderProgress.analyzingScenes;
+				args->totalFrameCount = transcoderProgress.totalFrameCount;
+				args->decodedFrameCount = transcoderProgress.decodedFrameCount;
+				args->filteredFrameCount = transcoderProgress.filteredFrameCount;
+				args->encodedFrameCount = transcoderProgress.encodedFrameCount;
+				args->decodeFps = transcoderProgress.decodeFps;
+				args->filterFps = transcoderProgress.filterFps;
+				args->encodeFps = transcoderProgress.encodeFps;
+				args->decodedQueueDepth = transcoderProgress.decodedQueueDepth;
+				args->filteredQueueDepth = transcoderProgress.filteredQueueDepth;
+				args->bytesWritten = transcoderProgress.bytesWritten;
+				args->elapsed = transcoderProgress.elapsed;
+				args->eta = transcoderProgress.eta;
+
+				progress(*this, args.as<CuteVideoEditor_Video::TranscodeProgressEventArgs>());
+			});
+		transcoder->SetFrameCallback([&](FFmpegController& controller, AVFrame* frame, uint64_t frameIndex) { ReportFrameOutputProgress(controller, frame, frameIndex); });
+
+		transcoder->Run(transcoderInput, transcoderOutputs);
+	}
+
+	void Transcode::ReportFrameOutputProgress(FFmpegController& controller, AVFrame* frame, uint64_t frameIndex)
+	{
+		// only build a preview when someone asked for one
+		if (!framePreviewRequested.exchange(false))
+			return;
 
-				SoftwareBitmap softwareFrameBitmap{ BitmapPixelFormat::Bgra8, frameBitmap->width, frameBitmap->height };
-				auto softwareBitmapBuffer = softwareFrameBitmap.LockBuffer(BitmapBufferAccessMode::Write);
-				auto softwareBitmapBufferData = softwareBitmapBuffer.CreateReference().data();
-				memcpy(softwareBitmapBufferData, frameBitmap->data[0], frameBitmap->linesize[0] * frameBitmap->height);
+		lock_guard lock(frameOutputProgressMutex);
 
-				ffmpegController->ReleaseTemporaryFrame(frameBitmap);
-				frameOutputProgress(*this, make<TranscodeFrameOutputProgressEventArgs>(encodedFrameIndex, softwareFrameBitmap));
-			}
+		auto [width, height] = controller.GetPreviewSize(frame, 600, 600);
+		SoftwareBitmap softwareFrameBitmap{ BitmapPixelFormat::Bgra8, width, height };
+		ConvertFrameToBitmap(controller, frame, softwareFrameBitmap);
 
-			ffmpegController->EncodeFrame(frame);
-		}
+		frameOutputProgress(*this, make<TranscodeFrameOutputProgressEventArgs>(frameIndex + 1, softwareFrameBitmap));
 	}
 
 	void Transcode::Close()
 	{
 		// dispose pattern
-		ffmpegController.reset();
+		transcoder.reset();
 	}
 }
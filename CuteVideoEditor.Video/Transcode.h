@@ -4,10 +4,13 @@
 #include "TranscodeInputCropFrameEntry.g.h"
 #include "TranscodeInputTrimmingMarkerEntry.g.h"
 #include "TranscodeInput.g.h"
+#include "TranscodeRendition.g.h"
 #include "TranscodeOutput.g.h"
 #include "TranscodeFrameOutputProgressEventArgs.g.h"
+#include "TranscodeProgressEventArgs.g.h"
 #include "Transcode.g.h"
 
+class Transcoder;
 class FFmpegController;
 
 namespace winrt::CuteVideoEditor_Video::implementation
@@ -118,6 +121,24 @@ namespace winrt::CuteVideoEditor_Video::implementation
 		hstring encoder_title;
 	};
 
+	struct TranscodeRendition : TranscodeRenditionT<TranscodeRendition>
+	{
+		Windows::Foundation::Size PixelSize() const { return pixelSize; }
+		uint32_t CRF() const { return crf; }
+
+		uint32_t MaxBitrateKbps() const { return maxBitrateKbps; }
+		void MaxBitrateKbps(uint32_t const value) { maxBitrateKbps = value; }
+
+		TranscodeRendition(Windows::Foundation::Size const& PixelSize, uint32_t CRF)
+			: pixelSize(PixelSize), crf(CRF)
+		{}
+
+	private:
+		Windows::Foundation::Size pixelSize;
+		uint32_t crf;
+		uint32_t maxBitrateKbps{};
+	};
+
 	struct TranscodeOutput : TranscodeOutputT<TranscodeOutput>
 	{
 		hstring FileName() const { return filename; }
@@ -127,6 +148,27 @@ namespace winrt::CuteVideoEditor_Video::implementation
 		Windows::Foundation::Size PixelSize() const { return pixelSize; }
 		double FrameRateMultiplier() const { return frameRateMultiplier; }
 
+		bool SegmentParallel() const { return segmentParallel; }
+		void SegmentParallel(bool const value) { segmentParallel = value; }
+
+		bool SmartRender() const { return smartRender; }
+		void SmartRender(bool const value) { smartRender = value; }
+
+		RateControlMode RateControl() const { return rateControl; }
+		void RateControl(RateControlMode const value) { rateControl = value; }
+
+		uint32_t BitrateKbps() const { return bitrateKbps; }
+		void BitrateKbps(uint32_t const value) { bitrateKbps = value; }
+
+		bool SceneDetection() const { return sceneDetection; }
+		void SceneDetection(bool const value) { sceneDetection = value; }
+
+		Windows::Foundation::Collections::IVectorView<CuteVideoEditor_Video::TranscodeRendition> Renditions() const { return renditions; }
+		void Renditions(Windows::Foundation::Collections::IVectorView<CuteVideoEditor_Video::TranscodeRendition> const& value) { renditions = value; }
+
+		Windows::Foundation::TimeSpan SegmentDuration() const { return segmentDuration; }
+		void SegmentDuration(Windows::Foundation::TimeSpan const& value) { segmentDuration = value; }
+
 		TranscodeOutput(hstring const& FileName, OutputType Type, uint32_t CRF, double FrameRateMultiplier,
 			Windows::Foundation::Size const& PixelSize, OutputPresetType Preset)
 			: filename(FileName), type(Type), crf(CRF), frameRateMultiplier(FrameRateMultiplier), pixelSize(PixelSize), preset(Preset)
@@ -139,6 +181,13 @@ namespace winrt::CuteVideoEditor_Video::implementation
 		OutputPresetType preset;
 		Windows::Foundation::Size pixelSize;
 		double frameRateMultiplier;
+		bool segmentParallel{};
+		bool smartRender{};
+		RateControlMode rateControl{ RateControlMode::Crf };
+		uint32_t bitrateKbps{};
+		bool sceneDetection{};
+		Windows::Foundation::Collections::IVectorView<CuteVideoEditor_Video::TranscodeRendition> renditions;
+		Windows::Foundation::TimeSpan segmentDuration{ std::chrono::seconds(4) };
 	};
 
 	struct TranscodeFrameOutputProgressEventArgs : TranscodeFrameOutputProgressEventArgsT<TranscodeFrameOutputProgressEventArgs>
@@ -158,11 +207,46 @@ namespace winrt::CuteVideoEditor_Video::implementation
 		Windows::Graphics::Imaging::SoftwareBitmap frameBitmap{ nullptr };
 	};
 
+	struct TranscodeProgressEventArgs : TranscodeProgressEventArgsT<TranscodeProgressEventArgs>
+	{
+		bool AnalyzingScenes() const { return analyzingScenes; }
+		int64_t TotalFrameCount() const { return totalFrameCount; }
+		int64_t DecodedFrameCount() const { return decodedFrameCount; }
+		int64_t FilteredFrameCount() const { return filteredFrameCount; }
+		int64_t EncodedFrameCount() const { return encodedFrameCount; }
+		double DecodeFps() const { return decodeFps; }
+		double FilterFps() const { return filterFps; }
+		double EncodeFps() const { return encodeFps; }
+		int64_t DecodedQueueDepth() const { return decodedQueueDepth; }
+		int64_t FilteredQueueDepth() const { return filteredQueueDepth; }
+		int64_t BytesWritten() const { return bytesWritten; }
+		Windows::Foundation::TimeSpan Elapsed() const { return elapsed; }
+		Windows::Foundation::TimeSpan Eta() const { return eta; }
+
+		// filled in by Transcode
+		bool analyzingScenes{};
+		int64_t totalFrameCount{}, decodedFrameCount{}, filteredFrameCount{}, encodedFrameCount{};
+		double decodeFps{}, filterFps{}, encodeFps{};
+		int64_t decodedQueueDepth{}, filteredQueueDepth{};
+		int64_t bytesWritten{};
+		Windows::Foundation::TimeSpan elapsed{}, eta{};
+	};
+
 	struct Transcode : TranscodeT<Transcode>
 	{
 		Transcode();
 
 		void Run(CuteVideoEditor_Video::TranscodeInput const& input, CuteVideoEditor_Video::TranscodeOutput const& output);
+		void RunOutputs(CuteVideoEditor_Video::TranscodeInput const& input,
+			Windows::Foundation::Collections::IVectorView<CuteVideoEditor_Video::TranscodeOutput> const& outputs);
+
+		Windows::Foundation::TimeSpan ProgressInterval() const { return progressInterval; }
+		void ProgressInterval(Windows::Foundation::TimeSpan const& value) { progressInterval = value; }
+
+		winrt::event_token Progress(Windows::Foundation::EventHandler<CuteVideoEditor_Video::TranscodeProgressEventArgs> const& handler) { return progress.add(handler); }
+		void Progress(winrt::event_token const& token) noexcept { progress.remove(token); }
+
+		void RequestFramePreview() { framePreviewRequested = true; }
 
 		winrt::event_token FrameOutputProgress(Windows::Foundation::EventHandler<CuteVideoEditor_Video::TranscodeFrameOutputProgressEventArgs> const& handler) { return frameOutputProgress.add(handler); }
 		void FrameOutputProgress(winrt::event_token const& token) noexcept { frameOutputProgress.remove(token); }
@@ -171,7 +255,14 @@ namespace winrt::CuteVideoEditor_Video::implementation
 		void Close();
 
 	private:
-		std::unique_ptr<FFmpegController> ffmpegController;
+		void ReportFrameOutputProgress(FFmpegController& controller, AVFrame* frame, uint64_t frameIndex);
+
+		// the export itself runs in the portable engine, this only translates to and from WinRT
+		std::unique_ptr<Transcoder> transcoder;
+		std::mutex frameOutputProgressMutex;
+		std::atomic<bool> framePreviewRequested{};
+		Windows::Foundation::TimeSpan progressInterval{ std::chrono::milliseconds(500) };
+		winrt::event<Windows::Foundation::EventHandler<CuteVideoEditor_Video::TranscodeProgressEventArgs>> progress;
 		winrt::event<Windows::Foundation::EventHandler<CuteVideoEditor_Video::TranscodeFrameOutputProgressEventArgs>> frameOutputProgress;
 	};
 }
@@ -194,6 +285,10 @@ namespace winrt::CuteVideoEditor_Video::factory_implementation
 	{
 	};
 
+	struct TranscodeRendition : TranscodeRenditionT<TranscodeRendition, implementation::TranscodeRendition>
+	{
+	};
+
 	struct TranscodeOutput : TranscodeOutputT<TranscodeOutput, implementation::TranscodeOutput>
 	{
 	};
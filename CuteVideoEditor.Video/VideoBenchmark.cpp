@@ -0,0 +1,274 @@
+#include "pch.h"
+#include "VideoBenchmark.h"
+#include "EngineInterop.h"
+
+#include "VideoBenchmarkResult.g.cpp"
+#include "VideoBenchmark.g.cpp"
+
+#include <random>
+
+using namespace std;
+using namespace chrono;
+using namespace winrt;
+using namespace Windows::Foundation;
+using namespace Windows::Foundation::Collections;
+using namespace Windows::Graphics::Imaging;
+
+static void CheckAvResult(int ret)
+{
+	if (ret < 0)
+	{
+		char error[AV_ERROR_MAX_STRING_SIZE];
+		av_log(nullptr, AV_LOG_ERROR, "Benchmark FFmpeg error: %s.\n", av_make_error_string(error, sizeof(error), ret));
+		throw_hresult(E_FAIL);
+	}
+}
+
+static double Percentile(vector<double> values, double percentile)
+{
+	if (values.empty())
+		return 0;
+
+	sort(values.begin(), values.end());
+	return values[min(values.size() - 1, static_cast<size_t>(percentile * values.size()))];
+}
+
+namespace winrt::CuteVideoEditor_Video::implementation
+{
+	void VideoBenchmark::GenerateTestClip(hstring const& fileName, int32_t width, int32_t height, int32_t frameRate, int32_t frameCount)
+	{
+		auto fileNameUtf8 = StringUtils::PlatformStringToUtf8String(fileName);
+
+		AutoReleasePtr<AVFormatContext, avformat_free_context> formatContext;
+		CheckAvResult(avformat_alloc_output_context2(&formatContext, nullptr, nullptr, fileNameUtf8.c_str()));
+
+		auto codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+		if (!codec)
+			throw_hresult(E_NOTIMPL);
+
+		AutoReleasePtr<AVCodecContext, avcodec_free_context> codecContext = avcodec_alloc_context3(codec);
+		if (!codecContext)
+			throw_hresult(E_OUTOFMEMORY);
+
+		// what a camera would hand us: 4:2:0 with two second GOPs
+		codecContext->width = width;
+		codecContext->height = height;
+		codecContext->time_base = { 1, frameRate };
+		codecContext->framerate = { frameRate, 1 };
+		codecContext->pix_fmt = AV_PIX_FMT_YUV420P;
+		codecContext->gop_size = frameRate * 2;
+		codecContext->max_b_frames = 2;
+		CheckAvResult(av_opt_set(codecContext->priv_data, "preset", "veryfast", 0));
+		CheckAvResult(av_opt_set_int(codecContext->priv_data, "crf", 23, 0));
+		if (formatContext->oformat->flags & AVFMT_GLOBALHEADER)
+			codecContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+		CheckAvResult(avcodec_open2(&*codecContext, codec, nullptr));
+
+		auto stream = avformat_new_stream(&*formatContext, nullptr);
+		if (!stream)
+			throw_hresult(E_OUTOFMEMORY);
+		CheckAvResult(avcodec_parameters_from_context(stream->codecpar, &*codecContext));
+		stream->time_base = codecContext->time_base;
+
+		CheckAvResult(avio_open(&formatContext->pb, fileNameUtf8.c_str(), AVIO_FLAG_WRITE));
+		CheckAvResult(avformat_write_header(&*formatContext, nullptr));
+
+		AutoReleasePtr<AVFrame, av_frame_free> frame = av_frame_alloc();
+		AutoReleasePtr<AVPacket, av_packet_free> packet = av_packet_alloc();
+		if (!frame || !packet)
+			throw_hresult(E_OUTOFMEMORY);
+
+		frame->format = codecContext->pix_fmt;
+		frame->width = width;
+		frame->height = height;
+		CheckAvResult(av_frame_get_buffer(&*frame, 0));
+
+		auto writePackets = [&]
+			{
+				int ret;
+				while ((ret = avcodec_receive_packet(&*codecContext, &*packet)) >= 0)
+				{
+					av_packet_rescale_ts(&*packet, codecContext->time_base, stream->time_base);
+					packet->stream_index = stream->index;
+					CheckAvResult(av_interleaved_write_frame(&*formatContext, &*packet));
+				}
+				if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+					CheckAvResult(ret);
+			};
+
+		auto blockSize = max(2, height / 6);
+		auto blockRangeX = max(1, width - blockSize), blockRangeY = max(1, height - blockSize);
+		for (int32_t frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+		{
+			CheckAvResult(av_frame_make_writable(&*frame));
+
+			// a scrolling gradient with a hard scene change every five seconds, and a bouncing block on top
+			auto scene = frameIndex / (frameRate * 5);
+			for (int y = 0; y < height; ++y)
+				for (int x = 0; x < width; ++x)
+					frame->data[0][y * frame->linesize[0] + x] = static_cast<uint8_t>(x + y + frameIndex * 3 + scene * 64);
+			for (int y = 0; y < height / 2; ++y)
+				for (int x = 0; x < width / 2; ++x)
+				{
+					frame->data[1][y * frame->linesize[1] + x] = static_cast<uint8_t>(128 + y - frameIndex + scene * 40);
+					frame->data[2][y * frame->linesize[2] + x] = static_cast<uint8_t>(64 + x + frameIndex * 2);
+				}
+
+			auto blockX = (frameIndex * 8) % (2 * blockRangeX), blockY = (frameIndex * 5) % (2 * blockRangeY);
+			blockX = blockX < blockRangeX ? blockX : 2 * blockRangeX - blockX;
+			blockY = blockY < blockRangeY ? blockY : 2 * blockRangeY - blockY;
+			for (int y = blockY; y < min(blockY + blockSize, height); ++y)
+				memset(frame->data[0] + y * frame->linesize[0] + blockX, 235, min(blockSize, width - blockX));
+
+			frame->pts = frameIndex;
+			CheckAvResult(avcodec_send_frame(&*codecContext, &*frame));
+			writePackets();
+		}
+
+		CheckAvResult(avcodec_send_frame(&*codecContext, nullptr));
+		writePackets();
+
+		CheckAvResult(av_write_trailer(&*formatContext));
+		CheckAvResult(avio_closep(&formatContext->pb));
+	}
+
+	IVectorView<CuteVideoEditor_Video::VideoBenchmarkResult> VideoBenchmark::Run(hstring const& fileName, hstring const& outputDirectory)
+	{
+		constexpr int openIterations = 10;
+		constexpr int seekIterations = 100;
+		constexpr int previewIterations = 200;
+		constexpr int previewMaxWidth = 1280, previewMaxHeight = 720;
+
+		auto fileNameUtf8 = StringUtils::PlatformStringToUtf8String(fileName);
+
+		vector<CuteVideoEditor_Video::VideoBenchmarkResult> results;
+		auto addResult = [&](const string& name, double value, const char* unit)
+			{
+				av_log(nullptr, AV_LOG_INFO, "%s: %.3f %s\n", name.c_str(), value, unit);
+				results.push_back(make<VideoBenchmarkResult>(to_hstring(name), value, to_hstring(unit)));
+			};
+
+		// opening, with the packet index scan the editor does
+		{
+			vector<double> milliseconds;
+			for (int iteration = 0; iteration < openIterations; ++iteration)
+			{
+				auto start = steady_clock::now();
+				FFmpegController controller;
+				controller.OpenInputVideo(fileNameUtf8.c_str(), false, true);
+				milliseconds.push_back(duration<double, milli>(steady_clock::now() - start).count());
+			}
+
+			addResult("open_input.p50", Percentile(milliseconds, 0.5), "ms");
+			addResult("open_input.max", Percentile(milliseconds, 1), "ms");
+		}
+
+		// random seeks, the same positions on every run
+		{
+			FFmpegController controller;
+			controller.OpenInputVideo(fileNameUtf8.c_str(), false, true);
+
+			mt19937_64 random{ 42 };
+			uniform_int_distribution<int64_t> positions{ 0, max<int64_t>(0, controller.GetMediaDuration().count() - 1) };
+
+			vector<double> milliseconds;
+			for (int iteration = 0; iteration < seekIterations; ++iteration)
+			{
+				auto position = TimeSpan{ positions(random) };
+				auto start = steady_clock::now();
+				controller.Seek(position);
+				milliseconds.push_back(duration<double, milli>(steady_clock::now() - start).count());
+			}
+
+			addResult("seek.p50", Percentile(milliseconds, 0.5), "ms");
+			addResult("seek.p90", Percentile(milliseconds, 0.9), "ms");
+			addResult("seek.p99", Percentile(milliseconds, 0.99), "ms");
+		}
+
+		// sequential decoding, keeping the first frame around for the conversion benchmarks
+		AutoReleasePtr<AVFrame, av_frame_free> sampleFrame;
+		{
+			FFmpegController controller;
+			controller.OpenInputVideo(fileNameUtf8.c_str(), false);
+			controller.SetValidTrimmingRanges({});
+
+			int64_t frameCount = 0;
+			auto start = steady_clock::now();
+			for (auto frame : controller.EnumerateInputFrames())
+			{
+				if (!frame)
+					break;
+				if (!sampleFrame)
+					sampleFrame = av_frame_clone(frame);
+				++frameCount;
+			}
+			addResult("decode.fps", frameCount / max(duration<double>(steady_clock::now() - start).count(), 1e-3), "fps");
+
+			if (!sampleFrame)
+				throw_hresult(E_FAIL);
+
+			// preview conversion into a bitmap, the way the player does it
+			auto [previewWidth, previewHeight] = controller.GetPreviewSize(&*sampleFrame, previewMaxWidth, previewMaxHeight);
+			SoftwareBitmap bitmap{ BitmapPixelFormat::Bgra8, previewWidth, previewHeight };
+			start = steady_clock::now();
+			for (int iteration = 0; iteration < previewIterations; ++iteration)
+				ConvertFrameToBitmap(controller, &*sampleFrame, bitmap);
+			addResult("preview_convert.fps", previewIterations / max(duration<double>(steady_clock::now() - start).count(), 1e-3), "fps");
+
+			for (auto& kernelResult : PreviewConverter::Benchmark(&*sampleFrame, previewWidth, previewHeight, previewIterations / 4))
+				addResult(format("preview_kernel.{}", kernelResult.name), kernelResult.millisecondsPerFrame, "ms");
+		}
+
+		// full frame exports, one per output type whose encoder is in this FFmpeg build
+		struct ExportType
+		{
+			FFmpegControllerOutputType type;
+			const char* name;
+			const wchar_t* extension;
+			initializer_list<const char*> encoderNames;
+		};
+		const ExportType exportTypes[] =
+		{
+			{ FFmpegControllerOutputType::Mp4, "mp4", L".mp4", { "libx264" } },
+			{ FFmpegControllerOutputType::Mp4Hevc, "mp4_hevc", L".mp4", { "libx265" } },
+			{ FFmpegControllerOutputType::Vp8, "vp8", L".webm", { "libvpx" } },
+			{ FFmpegControllerOutputType::Vp9, "vp9", L".webm", { "libvpx-vp9" } },
+			{ FFmpegControllerOutputType::Av1, "av1", L".webm", { "libsvtav1", "libaom-av1" } },
+		};
+
+		auto width = sampleFrame->width & ~1, height = sampleFrame->height & ~1;
+		vector<FFmpegControllerCropFrame> cropFrames{ { 0, { width / 2, height / 2, width, height } } };
+
+		for (auto& exportType : exportTypes)
+		{
+			if (none_of(exportType.encoderNames.begin(), exportType.encoderNames.end(), [](auto name) { return avcodec_find_encoder_by_name(name) != nullptr; }))
+			{
+				av_log(nullptr, AV_LOG_WARNING, "No %s encoder in this FFmpeg build, skipping its export benchmark.\n", exportType.name);
+				continue;
+			}
+
+			auto outputPath = filesystem::path{ outputDirectory.c_str() } / (L"benchmark" + wstring{ exportType.extension });
+			auto outputFileNameUtf8 = StringUtils::PlatformStringToUtf8String(hstring{ outputPath.wstring() });
+
+			FFmpegControllerPipelineStats stats;
+			auto start = steady_clock::now();
+			{
+				FFmpegController controller;
+				controller.SetPipelineStats(stats);
+				controller.OpenInputVideo(fileNameUtf8.c_str(), false);
+				controller.SetValidTrimmingRanges({});
+				controller.OpenOutputVideo(outputFileNameUtf8.c_str(), exportType.type, 30, FFmpegControllerPresetType::VeryFast,
+					width, height, "CuteVideoEditor benchmark", cropFrames, false);
+				controller.RunEncodingPipeline([](AVFrame*) {});
+				controller.CloseOutputs();
+			}
+			addResult(format("export.{}.fps", exportType.name),
+				stats.encodedFrameCount / max(duration<double>(steady_clock::now() - start).count(), 1e-3), "fps");
+
+			error_code ec;
+			filesystem::remove(outputPath, ec);
+		}
+
+		return single_threaded_vector(move(results)).GetView();
+	}
+}
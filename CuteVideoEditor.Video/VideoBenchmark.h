@@ -0,0 +1,41 @@
+#pragma once
+
+#include "VideoBenchmarkResult.g.h"
+#include "VideoBenchmark.g.h"
+
+namespace winrt::CuteVideoEditor_Video::implementation
+{
+	struct VideoBenchmarkResult : VideoBenchmarkResultT<VideoBenchmarkResult>
+	{
+		hstring Name() const { return name; }
+		double Value() const { return value; }
+		hstring Unit() const { return unit; }
+
+		VideoBenchmarkResult(hstring const& name, double value, hstring const& unit)
+			: name(name), value(value), unit(unit)
+		{
+		}
+
+	private:
+		hstring name;
+		double value{};
+		hstring unit;
+	};
+
+	struct VideoBenchmark
+	{
+		static void GenerateTestClip(hstring const& fileName, int32_t width, int32_t height, int32_t frameRate, int32_t frameCount);
+		static Windows::Foundation::Collections::IVectorView<CuteVideoEditor_Video::VideoBenchmarkResult> Run(hstring const& fileName, hstring const& outputDirectory);
+	};
+}
+
+namespace winrt::CuteVideoEditor_Video::factory_implementation
+{
+	struct VideoBenchmarkResult : VideoBenchmarkResultT<VideoBenchmarkResult, implementation::VideoBenchmarkResult>
+	{
+	};
+
+	struct VideoBenchmark : VideoBenchmarkT<VideoBenchmark, implementation::VideoBenchmark>
+	{
+	};
+}
@@ -6,9 +6,13 @@
 #include <restrictederrorinfo.h>
 #include <hstring.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
 #include <functional>
 #include <format>
 #include <mutex>
+#include <thread>
 
 // prevent compiler warnings due to name conflicts
 #pragma push_macro("GetCurrentTime")
@@ -41,18 +45,13 @@
 
 #include <d3d11.h>
 
+// the portable engine brings the FFmpeg headers, only the Windows specific parts are included here
+#include "EngineCommon.h"
+
 extern "C"
 {
-#include <libavcodec/avcodec.h>
-#include <libavformat/avformat.h>
-#include <libswscale/swscale.h>
 #include <libswresample/swresample.h>
-#include <libavutil/imgutils.h>
-#include <libavutil/opt.h>
 #include <libavutil/hwcontext_d3d11va.h>
-#include <libavfilter/buffersink.h>
-#include <libavfilter/buffersrc.h>
-#include <libavfilter/avfilter.h>
 }
 
 #include "stb_image.h"
@@ -63,8 +62,6 @@ extern "C"
 #pragma warning(default : 4244)
 
 #include "StringUtils.h"
-#include "autoreleaseptr.h"
-#include <asyncpp/generator.h>
 
 // Disable debug string output on non-debug build
 #if !_DEBUG
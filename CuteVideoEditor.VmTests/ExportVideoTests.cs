@@ -0,0 +1,86 @@
+using CuteVideoEditor.Core.Services;
+using CuteVideoEditor.ViewModels.Dialogs;
+using CuteVideoEditor_Video;
+
+namespace Cute_Video_Editor.VmTests;
+
+[TestClass]
+public class ExportVideoTests
+{
+    static ExportVideoViewModel CreateDefaultTestViewModel() =>
+        new(new SettingsService()) { FileName = @"C:\videos\output.mp4" };
+
+    [TestMethod]
+    public void UsesBitrate()
+    {
+        var vm = CreateDefaultTestViewModel();
+
+        vm.RateControl = RateControlMode.Crf;
+        Assert.IsFalse(vm.UsesBitrate);
+
+        vm.RateControl = RateControlMode.Vbv;
+        Assert.IsTrue(vm.UsesBitrate);
+
+        vm.RateControl = RateControlMode.TwoPass;
+        Assert.IsTrue(vm.UsesBitrate);
+    }
+
+    [TestMethod]
+    public void IsValidWithFileName()
+    {
+        var vm = CreateDefaultTestViewModel();
+        foreach (var rateControl in vm.RateControlModes)
+        {
+            vm.RateControl = rateControl;
+            Assert.IsTrue(vm.IsValid, rateControl.ToString());
+        }
+    }
+
+    [TestMethod]
+    public void IsValidWithoutFileName()
+    {
+        var vm = CreateDefaultTestViewModel();
+        foreach (var fileName in new[] { null, "", "  " })
+        {
+            vm.FileName = fileName;
+            foreach (var rateControl in vm.RateControlModes)
+            {
+                vm.RateControl = rateControl;
+                Assert.IsFalse(vm.IsValid, rateControl.ToString());
+            }
+        }
+    }
+
+    [TestMethod]
+    public void IsValidWithoutBitrate()
+    {
+        var vm = CreateDefaultTestViewModel();
+        vm.BitrateKbps = 0;
+
+        // only the modes targeting a bitrate need one
+        vm.RateControl = RateControlMode.Crf;
+        Assert.IsTrue(vm.IsValid);
+
+        vm.RateControl = RateControlMode.Vbv;
+        Assert.IsFalse(vm.IsValid);
+
+        vm.RateControl = RateControlMode.TwoPass;
+        Assert.IsFalse(vm.IsValid);
+    }
+
+    [TestMethod]
+    public void IsValidNotifications()
+    {
+        var vm = CreateDefaultTestViewModel();
+        var changedProperties = new List<string?>();
+        vm.PropertyChanged += (_, e) => changedProperties.Add(e.PropertyName);
+
+        vm.RateControl = RateControlMode.Vbv;
+        CollectionAssert.Contains(changedProperties, nameof(vm.UsesBitrate));
+        CollectionAssert.Contains(changedProperties, nameof(vm.IsValid));
+
+        changedProperties.Clear();
+        vm.BitrateKbps = 0;
+        CollectionAssert.Contains(changedProperties, nameof(vm.IsValid));
+    }
+}
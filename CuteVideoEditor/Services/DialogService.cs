@@ -106,6 +106,7 @@ public class DialogService(IServiceProvider serviceProvider, SettingsService set
             var output = dlg.ViewModel.BuildTranscodeOutputProperties(mainViewModel);
             settingsService.LastCrf = output.Crf;
             settingsService.LastVideoOutputType = output.OutputType;
+            settingsService.LastOutputPreset = output.Preset;
             return output;
         }
         finally
@@ -7,15 +7,32 @@ using Windows.Graphics.Imaging;
 namespace CuteVideoEditor.Services;
 class VideoTranscoderService(IMapper mapper) : IVideoTranscoderService
 {
-    public void Transcode(VideoTranscodeInput input, VideoTranscodeOutput output, Action<ulong, SoftwareBitmap> frameProcessed)
+    public void Transcode(VideoTranscodeInput input, VideoTranscodeOutput output, Action<TranscodeProgressEventArgs> progress,
+        Action<SoftwareBitmap>? framePreview = null)
     {
         using var transcoder = new Transcode();
-        transcoder.FrameOutputProgress += (s, e) => frameProcessed(e.FrameNumber, e.FrameBitmap);
+        transcoder.Progress += (s, e) =>
+        {
+            progress(e);
+
+            // one preview per progress report, and none at all without a consumer
+            if (framePreview is not null)
+                transcoder.RequestFramePreview();
+        };
+        if (framePreview is not null)
+            transcoder.FrameOutputProgress += (s, e) => framePreview(e.FrameBitmap);
         transcoder.Run(new(input.FileName, 0,
                 mapper.Map<List<TranscodeInputCropFrameEntry>>(input.CropFrames),
                 mapper.Map<List<TranscodeInputTrimmingMarkerEntry>>(input.TrimmingMarkers),
                 input.EncoderTitle),
             new(output.FileName, output.OutputType, output.Crf, output.FrameRateMultiplier,
-                new(output.PixelWidth, output.PixelHeight), OutputPresetType.Medium));
+                new(output.PixelWidth, output.PixelHeight), output.Preset)
+            {
+                SegmentParallel = output.SegmentParallel,
+                SmartRender = output.SmartRender,
+                RateControl = output.RateControl,
+                BitrateKbps = output.BitrateKbps,
+                SceneDetection = output.SceneDetection
+            });
     }
 }
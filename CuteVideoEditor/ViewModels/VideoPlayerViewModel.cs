@@ -18,6 +18,9 @@ partial class VideoPlayerViewModel : ObservableObject, IVideoPlayerViewModel, ID
         nameof(OutputMediaPosition), nameof(OutputMediaDuration), nameof(OutputFrameNumber))]
     string? mediaFileName;
 
+    // sidecar file caching the media's packet index, picked up by the next media file change
+    public string? PacketIndexFileName { get; set; }
+
     [ObservableProperty]
     [NotifyPropertyChangedFor(nameof(MediaFrameRate),
         nameof(InputMediaDuration), nameof(InputFrameNumber),
@@ -31,6 +34,16 @@ partial class VideoPlayerViewModel : ObservableObject, IVideoPlayerViewModel, ID
     [ObservableProperty]
     MediaPlayerState mediaPlayerState;
 
+    // the largest size the player shows frames at, in physical pixels
+    [ObservableProperty]
+    SizeModel previewPixelSize;
+
+    [ObservableProperty]
+    bool fullResolutionPreview;
+
+    [ObservableProperty]
+    bool scrubbing;
+
     public ObservableCollection<TrimmingMarkerModel> TrimmingMarkers { get; } = [new(0)];
 
     public event EventHandler<SoftwareBitmap?>? FrameReady;
@@ -167,19 +180,25 @@ partial class VideoPlayerViewModel : ObservableObject, IVideoPlayerViewModel, ID
         if (imageReader is not null)
         {
             FrameReady?.Invoke(this, imageReader.CurrentFrameBitmap);
-            NewFrameGeometry?.Invoke(this, new(imageReader.CurrentFrameBitmap.PixelWidth, imageReader.CurrentFrameBitmap.PixelHeight));
+            NewFrameGeometry?.Invoke(this, new(imageReader.PixelWidth, imageReader.PixelHeight));
         }
     }
 
     partial void OnMediaFileNameChanged(string? value)
     {
         imageReader?.Dispose();
-        imageReader = value is null ? null : new(value);
+        imageReader = value is null ? null
+            : PacketIndexFileName is { } packetIndexFileName ? new(value, packetIndexFileName)
+            : new(value);
 
         if (imageReader is not null)
         {
             MediaFrameRate = imageReader.FrameRate;
             InputMediaDuration = imageReader.MediaDuration;
+
+            imageReader.SetPreviewSize(PreviewPixelSize.Width, PreviewPixelSize.Height);
+            imageReader.FullResolution = FullResolutionPreview;
+            imageReader.Scrubbing = Scrubbing;
         }
 
         OutputFrameNumber = 0;
@@ -217,6 +236,30 @@ partial class VideoPlayerViewModel : ObservableObject, IVideoPlayerViewModel, ID
         }
     }
 
+    partial void OnPreviewPixelSizeChanged(SizeModel value)
+    {
+        if (imageReader is not null)
+        {
+            imageReader.SetPreviewSize(value.Width, value.Height);
+            TriggerFrameReady();
+        }
+    }
+
+    partial void OnFullResolutionPreviewChanged(bool value)
+    {
+        if (imageReader is not null)
+        {
+            imageReader.FullResolution = value;
+            TriggerFrameReady();
+        }
+    }
+
+    partial void OnScrubbingChanged(bool value)
+    {
+        if (imageReader is not null)
+            imageReader.Scrubbing = value;
+    }
+
     partial void OnInputMediaPositionChanged(TimeSpan value)
     {
         if (imageReader is not null)
@@ -75,11 +75,22 @@ public sealed partial class CropBoxControl : UserControl
         if (dragStartPoint.HasValue && e.Pointer.PointerDeviceType is PointerDeviceType.Mouse)
         {
             ReleasePointerCapture(e.Pointer);
-            dragStartPoint = null;
+            EndDrag();
             e.Handled = true;
         }
     }
 
+    protected override void OnPointerCaptureLost(PointerRoutedEventArgs e) => EndDrag();
+
+    void EndDrag()
+    {
+        dragStartPoint = null;
+
+        // back to frames sized to the player once the crop is placed
+        if (ViewModel is not null)
+            ViewModel.VideoPlayerViewModel.FullResolutionPreview = false;
+    }
+
     static readonly InputCursor moveCursor = InputCursor.CreateFromCoreCursor(new(Windows.UI.Core.CoreCursorType.SizeAll, 0));
     static readonly InputCursor sizeNWSECursor = InputCursor.CreateFromCoreCursor(new(Windows.UI.Core.CoreCursorType.SizeNorthwestSoutheast, 0));
     protected override void OnPointerMoved(PointerRoutedEventArgs e)
@@ -94,6 +105,9 @@ public sealed partial class CropBoxControl : UserControl
                     && (Math.Abs(pt.Position.X - dragStartPoint.Value.X) > minDragDistance || Math.Abs(pt.Position.Y - dragStartPoint.Value.Y) > minDragDistance))
                 {
                     actualDragStarted = true;
+
+                    // place the crop edges against the source pixels, not a downscaled preview
+                    ViewModel!.VideoPlayerViewModel.FullResolutionPreview = true;
                 }
             }
 
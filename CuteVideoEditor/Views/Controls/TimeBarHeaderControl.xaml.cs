@@ -2,10 +2,14 @@ using CommunityToolkit.Mvvm.ComponentModel;
 using CuteVideoEditor.Core.Helpers;
 using CuteVideoEditor.Core.Models;
 using CuteVideoEditor.ViewModels;
+using CuteVideoEditor_Video;
 using Microsoft.UI.Xaml;
 using Microsoft.UI.Xaml.Controls;
 using Microsoft.UI.Xaml.Input;
+using Microsoft.UI.Xaml.Media;
+using Microsoft.UI.Xaml.Media.Imaging;
 using System.Collections.ObjectModel;
+using Windows.Foundation;
 
 namespace CuteVideoEditor.Views.Controls;
 
@@ -48,6 +52,7 @@ public sealed partial class TimeBarHeaderControl : UserControl
     public ObservableCollection<TimeBarHeaderControlDisjunctTrimmingMarkerEntry> DisjunctOutputTrims { get; } = [];
     public ObservableCollection<TimeBarHeaderControlNonDisjunctMarkerEntry> NonDisjunctOutputMarkers { get; } = [];
     public ObservableCollection<TimeBarHeaderControlCropFrameEntry> CropFrames { get; } = [];
+    public ObservableCollection<TimeBarHeaderControlThumbnailEntry> Thumbnails { get; } = [];
 
     [ObservableProperty]
     TimeBarHeaderControlTickEntry positionTick;
@@ -59,6 +64,62 @@ public sealed partial class TimeBarHeaderControl : UserControl
             DisjunctOutputTrims.KeepInSync(ViewModel.DisjunctOutputTrims, w => new(w, this));
             NonDisjunctOutputMarkers.KeepInSync(ViewModel.NonDisjunctOutputMarkers, w => new(w, this));
             CropFrames.KeepInSync(ViewModel.CropFrames, w => new(ViewModel, w, this));
+
+            ViewModel.VideoPlayerViewModel.PropertyChanged += (s, e) =>
+            {
+                if (e.PropertyName is nameof(ViewModel.VideoPlayerViewModel.MediaFileName))
+                    GenerateThumbnails();
+            };
+        }
+        GenerateThumbnails();
+    }
+
+    // keyframe thumbnails spread evenly over the input, generated in the background and placed on the output time
+    // bar as they arrive; the ones in trimmed parts are left out
+    readonly double thumbnailWidth, thumbnailHeight;
+    readonly List<(TimeSpan Position, ImageSource Source)> generatedThumbnails = [];
+    ThumbnailGenerator? thumbnailGenerator;
+    IAsyncAction? thumbnailGeneration;
+    int thumbnailCount;
+
+    void GenerateThumbnails()
+    {
+        thumbnailGeneration?.Cancel();
+        thumbnailGenerator?.Dispose();
+        thumbnailGenerator = null;
+        generatedThumbnails.Clear();
+        Thumbnails.Clear();
+
+        thumbnailCount = (int)(ActualWidth / thumbnailWidth);
+        if (ViewModel?.VideoPlayerViewModel.MediaFileName is not { } mediaFileName || thumbnailCount <= 0)
+            return;
+
+        // raised on the generator's worker threads
+        var generator = thumbnailGenerator = new(mediaFileName);
+        generator.ThumbnailGenerated += (s, e) => DispatcherQueue.TryEnqueue(async () =>
+        {
+            var source = new SoftwareBitmapSource();
+            await source.SetBitmapAsync(e.Bitmap);
+
+            // another file or width replaced this generation in the meantime
+            if (generator != thumbnailGenerator)
+                return;
+
+            generatedThumbnails.Add((e.Position, source));
+            AddThumbnail(e.Position, source);
+        });
+
+        var scale = XamlRoot?.RasterizationScale ?? 1;
+        thumbnailGeneration = generator.GenerateAsync(thumbnailCount, (int)(thumbnailWidth * scale), (int)(thumbnailHeight * scale));
+    }
+
+    void AddThumbnail(TimeSpan position, ImageSource source)
+    {
+        var inputFrameNumber = ViewModel!.VideoPlayerViewModel.GetFrameNumberFromPosition(position);
+        if (ViewModel.VideoPlayerViewModel.GetNextNonTrimmedInputFrameNumber(inputFrameNumber, true, out var nonTrimmedInputFrameNumber)
+            && nonTrimmedInputFrameNumber == inputFrameNumber)
+        {
+            Thumbnails.Add(new(ViewModel, inputFrameNumber, source, this));
         }
     }
 
@@ -83,6 +144,12 @@ public sealed partial class TimeBarHeaderControl : UserControl
                     Ticks.Add(new(tick + tickDuration * 0.75, 0.25f, this));
                 }
             }
+
+            // the trims moved the output positions
+            Thumbnails.Clear();
+            if (ViewModel is not null)
+                foreach (var (position, source) in generatedThumbnails)
+                    AddThumbnail(position, source);
         }
 
         if ((rebuildType & RebuildType.Position) != 0)
@@ -99,18 +166,64 @@ public sealed partial class TimeBarHeaderControl : UserControl
     public TimeBarHeaderControl()
     {
         InitializeComponent();
+        thumbnailWidth = (double)Resources["ThumbnailWidth"];
+        thumbnailHeight = (double)Resources["ThumbnailHeight"];
 
-        SizeChanged += (s, e) => Rebuild(RebuildType.All);
+        SizeChanged += (s, e) =>
+        {
+            if ((int)(ActualWidth / thumbnailWidth) != thumbnailCount)
+                GenerateThumbnails();
+            Rebuild(RebuildType.All);
+        };
+        Unloaded += (s, e) =>
+        {
+            thumbnailGeneration?.Cancel();
+            thumbnailGenerator?.Dispose();
+            thumbnailGenerator = null;
+        };
     }
 
     protected override void OnPointerPressed(PointerRoutedEventArgs e)
     {
         var ppt = e.GetCurrentPoint(this);
         if (ppt.PointerDeviceType is Microsoft.UI.Input.PointerDeviceType.Mouse && ppt.Properties.IsLeftButtonPressed)
-            ViewModel!.VideoPlayerViewModel.OutputMediaPosition = TimeSpan.FromSeconds(
-                ViewModel!.VideoPlayerViewModel.OutputMediaDuration.TotalSeconds * ppt.Position.X / ActualWidth);
+        {
+            CapturePointer(e.Pointer);
+            ViewModel!.VideoPlayerViewModel.Scrubbing = true;
+            SetPositionFromPointer(ppt.Position.X);
+        }
     }
 
+    protected override void OnPointerMoved(PointerRoutedEventArgs e)
+    {
+        var ppt = e.GetCurrentPoint(this);
+        if (ViewModel!.VideoPlayerViewModel.Scrubbing && ppt.Properties.IsLeftButtonPressed)
+            SetPositionFromPointer(ppt.Position.X);
+    }
+
+    protected override void OnPointerReleased(PointerRoutedEventArgs e)
+    {
+        ReleasePointerCapture(e.Pointer);
+        StopScrubbing();
+    }
+
+    protected override void OnPointerCaptureLost(PointerRoutedEventArgs e) => StopScrubbing();
+
+    void StopScrubbing()
+    {
+        if (ViewModel!.VideoPlayerViewModel.Scrubbing)
+        {
+            ViewModel.VideoPlayerViewModel.Scrubbing = false;
+
+            // the reader decoded the frame we stopped on again at full quality
+            ViewModel.VideoPlayerViewModel.TriggerFrameReady();
+        }
+    }
+
+    void SetPositionFromPointer(double x) =>
+        ViewModel!.VideoPlayerViewModel.OutputMediaPosition = TimeSpan.FromSeconds(
+            ViewModel!.VideoPlayerViewModel.OutputMediaDuration.TotalSeconds * Math.Clamp(x / ActualWidth, 0, 1));
+
     public static double GetXOffset(TimeSpan timeSpan, TimeBarHeaderControl? timeBarHeader) => timeBarHeader is null ? 0 :
         (timeSpan - timeBarHeader.Start).TotalSeconds / (timeBarHeader.End - timeBarHeader.Start).TotalSeconds * timeBarHeader.ActualWidth /*+ 4*/;
 
@@ -153,6 +266,18 @@ public readonly struct TimeBarHeaderControlNonDisjunctMarkerEntry
         (Position, TimeBarHeader) = (position, timeBarHeader);
 }
 
+public readonly struct TimeBarHeaderControlThumbnailEntry
+{
+    public readonly TimeSpan Position;
+    public readonly ImageSource Source;
+    public readonly TimeBarHeaderControl TimeBarHeader;
+
+    public TimeBarHeaderControlThumbnailEntry(VideoEditorViewModel vm, long inputFrameNumber, ImageSource source, TimeBarHeaderControl timeBarHeader) =>
+        (Position, Source, TimeBarHeader) =
+            (vm.VideoPlayerViewModel.GetPositionFromFrameNumber(vm.VideoPlayerViewModel.GetOutputFrameNumberFromInputFrameNumber(inputFrameNumber)),
+                source, timeBarHeader);
+}
+
 public readonly struct TimeBarHeaderControlCropFrameEntry
 {
     public readonly TimeSpan Position;
@@ -13,6 +13,10 @@ public sealed partial class VideoEditorPage : Page
         InitializeComponent();
         
         Unloaded += (s, e) => ViewModel.Dispose();
-        videoPlayerControl.SizeChanged += (s, e) => ViewModel.VideoPlayerPixelSize = new((int)e.NewSize.Width, (int)e.NewSize.Height);
+        videoPlayerControl.SizeChanged += (s, e) =>
+        {
+            ViewModel.VideoPlayerPixelSize = new((int)e.NewSize.Width, (int)e.NewSize.Height);
+            ViewModel.VideoPlayerViewModel.PreviewPixelSize = ViewModel.VideoPlayerPixelSize * (XamlRoot?.RasterizationScale ?? 1);
+        };
     }
 }